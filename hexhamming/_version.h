@@ -1 +1,12 @@
-const char _version[] = "2.2.3";
+#ifndef HEXHAMMING_VERSION_H
+#define HEXHAMMING_VERSION_H
+
+namespace hexhamming {
+namespace detail {
+
+inline constexpr char _version[] = "2.2.3";
+
+}  // namespace detail
+}  // namespace hexhamming
+
+#endif  //HEXHAMMING_VERSION_H
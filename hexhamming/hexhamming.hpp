@@ -0,0 +1,307 @@
+#ifndef HEXHAMMING_HPP
+#define HEXHAMMING_HPP
+
+/* C++17 interface to the hexhamming kernels, independent of Python.
+
+   hexhamming::dispatcher holds the kernel table picked for the CPU (or a requested algorithm) and
+   exposes the kernels over spans of bytes. Everything is header only: link the CMake target
+   `hexhamming::hexhamming` or add the repository root to the include path. */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "kernels.h"
+#include "_version.h"
+
+namespace hexhamming {
+
+inline constexpr const char* version = detail::_version;
+
+/**
+ * Read-only view of contiguous elements, a subset of C++20 std::span.
+ */
+template <typename T>
+class span {
+public:
+    constexpr span() noexcept : data_(nullptr), size_(0) {}
+    constexpr span(T* data, std::size_t size) noexcept : data_(data), size_(size) {}
+    template <std::size_t N>
+    constexpr span(T (&array)[N]) noexcept : data_(array), size_(N) {}
+    template <typename Container,
+              typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<Container&>().data()), T*>>>
+    constexpr span(Container& container) noexcept : data_(container.data()), size_(container.size()) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr std::size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr T& operator[](std::size_t i) const noexcept { return data_[i]; }
+
+private:
+    T* data_;
+    std::size_t size_;
+};
+
+typedef span<const uint8_t> bytes_view;
+
+// Fixed width record, e.g. record<8> for 64-bit perceptual hashes.
+template <std::size_t Bytes>
+using record = std::array<uint8_t, Bytes>;
+
+enum class algorithm {
+    avx512 = detail::KERNELS_ID_AVX512,
+    extra = detail::KERNELS_ID_EXTRA,
+    native = detail::KERNELS_ID_NATIVE,
+    sse41 = detail::KERNELS_ID_SSE41,
+    classic = detail::KERNELS_ID_CLASSIC
+};
+
+/**
+ * Returns CPU feature bits (`detail::CPU_AVX2`, `detail::CPU_POPCNT`, ...) the kernel tables are selected by.
+ */
+inline int cpu_capabilities() {
+#if defined(HEXHAMMING_X86_64)
+    static const int capabilities = detail::get_cpuid();
+    return capabilities;
+#elif defined(HEXHAMMING_HAVE_NATIVE_POPCNT)
+    return detail::CPU_POPCNT;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Parses algorithm name as used by the Python `set_algo`: "avx512", "extra", "native", "sse41" or "classic".
+ */
+inline std::optional<algorithm> parse_algorithm(const std::string_view name) {
+    if (name == "avx512")
+        return algorithm::avx512;
+    if (name == "extra")
+        return algorithm::extra;
+    if (name == "native")
+        return algorithm::native;
+    if (name == "sse41")
+        return algorithm::sse41;
+    if (name == "classic")
+        return algorithm::classic;
+    return std::nullopt;
+}
+
+/**
+ * Returns kernel table of `algo`, or nullptr if the library was built without it.
+ */
+inline const detail::hexhamming_kernels* algorithm_kernels(const algorithm algo) {
+    switch (algo) {
+#if defined(HEXHAMMING_HAVE_AVX512)
+    case algorithm::avx512:
+        return &detail::KERNELS__AVX512;
+#endif
+    case algorithm::extra:
+        return &detail::KERNELS__EXTRA;
+#if defined(HEXHAMMING_HAVE_NATIVE_POPCNT)
+    case algorithm::native:
+        return &detail::KERNELS__NATIVE;
+#endif
+#if defined(HEXHAMMING_X86_64)
+    case algorithm::sse41:
+        return &detail::KERNELS__SSE41;
+#endif
+    case algorithm::classic:
+        return &detail::KERNELS__CLASSIC;
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * Returns true if CPU with `capabilities` can run kernels of `algo`.
+ */
+inline bool algorithm_supported(const algorithm algo, const int capabilities) {
+    switch (algo) {
+    case algorithm::avx512:
+        return (capabilities & (detail::CPU_AVX2 | detail::CPU_AVX512)) == (detail::CPU_AVX2 | detail::CPU_AVX512);
+    case algorithm::extra:
+        return (capabilities & detail::CPU_AVX2) == detail::CPU_AVX2;
+    case algorithm::native:
+#if defined(HEXHAMMING_X86_64)
+        // strings are compared by the SSE4.1 kernel
+        return (capabilities & (detail::CPU_POPCNT | detail::CPU_SSE41)) == (detail::CPU_POPCNT | detail::CPU_SSE41);
+#else
+        return (capabilities & detail::CPU_POPCNT) == detail::CPU_POPCNT;
+#endif
+    case algorithm::sse41:
+        return (capabilities & detail::CPU_SSE41) == detail::CPU_SSE41;
+    default:
+        return true;
+    }
+}
+
+/**
+ * Byte positions of records of `elem_size` bytes, most likely to differ first, measured on at most
+ * `sample_size` of `records`. Searches over records and queries passed through `permute` with it
+ * return the same results and reject records after fewer bytes.
+ */
+inline std::vector<uint64_t> variance_permutation(const bytes_view records, const std::size_t elem_size,
+                                                  const uint64_t sample_size = 4096) {
+    if (elem_size == 0)
+        throw std::invalid_argument("`elem_size` must be >0");
+    if (records.size() % elem_size != 0)
+        throw std::invalid_argument("`array_of_elems` size must be multiplier of `elem_size`");
+    std::vector<uint64_t> permutation(elem_size);
+    detail::variance_permutation_bytes(records.data(), records.size() / elem_size, elem_size, sample_size,
+                                       permutation.data());
+    return permutation;
+}
+
+// Copy of `records` where byte `k` of every record is byte `permutation[k]` of the original one.
+inline std::vector<uint8_t> permute(const bytes_view records, const span<const uint64_t> permutation) {
+    if (permutation.empty() || !detail::is_byte_permutation(permutation.data(), permutation.size()))
+        throw std::invalid_argument("`permutation` must hold every position of an element once");
+    if (records.size() % permutation.size() != 0)
+        throw std::invalid_argument("`array_of_elems` size must be multiplier of `permutation` size");
+    std::vector<uint8_t> permuted(records.size());
+    detail::permute_bytes_array(records.data(), records.size() / permutation.size(), permutation.size(),
+                                permutation.data(), permuted.data());
+    return permuted;
+}
+
+/**
+ * Entry point of the C++ interface. Copies are cheap: only a pointer to a static kernel table.
+ *
+ * Sizes are checked and reported with std::invalid_argument; distances over packed records use
+ * the batch kernels for 8 and 16 bytes records.
+ */
+class dispatcher {
+public:
+    // Fastest kernels supported by this CPU.
+    dispatcher() : table(detail::best_kernels(cpu_capabilities())) {}
+
+    explicit dispatcher(const detail::hexhamming_kernels* kernels) : table(kernels) {}
+
+    // Kernels of `algo`, throws std::invalid_argument if not built or not supported by this CPU.
+    explicit dispatcher(const algorithm algo) : table(algorithm_kernels(algo)) {
+        if (table == nullptr)
+            throw std::invalid_argument("library was built without this algorithm");
+        if (!algorithm_supported(algo, cpu_capabilities()))
+            throw std::invalid_argument("CPU does not support this algorithm");
+    }
+
+    const detail::hexhamming_kernels* kernels() const {
+        return table;
+    }
+
+    uint64_t distance(const bytes_view a, const bytes_view b) const {
+        check_same_size(a, b);
+        return table->hamming_distance_bytes(a.data(), b.data(), a.size(), -1);
+    }
+
+    bool within(const bytes_view a, const bytes_view b, const uint64_t max_dist) const {
+        check_same_size(a, b);
+        return table->hamming_distance_bytes(a.data(), b.data(), a.size(), clamp(max_dist)) == 1;
+    }
+
+    // Distance of the bits of two hexadecimal strings.
+    uint64_t distance(const std::string_view a, const std::string_view b) const {
+        if (a.size() != b.size())
+            throw std::invalid_argument("strings are NOT the same length");
+        const uint64_t result = table->hamming_distance_string(a.data(), b.data(), a.size());
+        if (result == UINT64_MAX)
+            throw std::invalid_argument("hex string contains invalid char");
+        return result;
+    }
+
+    // Returns {popcount(a & b), popcount(a | b)}.
+    std::pair<uint64_t, uint64_t> and_or_count(const bytes_view a, const bytes_view b) const {
+        check_same_size(a, b);
+        uint64_t and_count, or_count;
+        table->and_or_popcount_bytes(a.data(), b.data(), a.size(), &and_count, &or_count);
+        return std::make_pair(and_count, or_count);
+    }
+
+    /**
+     * Returns index of the first record of `records` (packed, `query.size()` bytes each) within
+     * `max_dist` of `query` or -1.
+     */
+    int64_t find_within_dist(const bytes_view records, const bytes_view query, const uint64_t max_dist) const {
+        return detail::find_within_dist(table, records.data(), count_records(records, query), query.data(),
+                                        query.size(), clamp(max_dist));
+    }
+
+    // Number of records within `max_dist` of `query`.
+    uint64_t count_within_dist(const bytes_view records, const bytes_view query, const uint64_t max_dist) const {
+        return detail::count_within_dist_bytes(detail::bytes_kernel_for_length(table, query.size()),
+                                               records.data(), count_records(records, query), query.data(), 1,
+                                               query.size(), clamp(max_dist));
+    }
+
+    // Stores distance of every record to `query` to `distances`, which must have one item per record.
+    void distances(const bytes_view records, const bytes_view query, const span<uint64_t> distances) const {
+        const uint64_t number_of_elements = count_records(records, query);
+        if (distances.size() != number_of_elements)
+            throw std::invalid_argument("`distances` size must be equal to number of records");
+        const detail::hamming_distance_bytes_fn distance = detail::bytes_kernel_for_length(table, query.size());
+        for (uint64_t i = 0; i < number_of_elements; i++)
+            distances[i] = distance(records.data() + i * query.size(), query.data(), query.size(), -1);
+    }
+
+    // Fixed width variants, kernels are chosen at compile time by the record size.
+    template <std::size_t Bytes>
+    uint64_t distance(const record<Bytes>& a, const record<Bytes>& b) const {
+        return fixed_kernel<Bytes>()(a.data(), b.data(), Bytes, -1);
+    }
+
+    template <std::size_t Bytes>
+    int64_t find_within_dist(const span<const record<Bytes>> records, const record<Bytes>& query,
+                             const uint64_t max_dist) const {
+        static_assert(sizeof(record<Bytes>) == Bytes, "records must be packed");
+        const uint8_t* packed = reinterpret_cast<const uint8_t*>(records.data());
+        if constexpr (Bytes % 8 == 0 && Bytes / 8 <= detail::BATCH_MAX_WORDS)
+            return table->find_within_dist_words[Bytes / 8 - 1](packed, records.size(), query.data(), clamp(max_dist));
+        else
+            return detail::find_within_dist_bytes(fixed_kernel<Bytes>(), packed, records.size(), query.data(),
+                                                  Bytes, clamp(max_dist));
+    }
+
+private:
+    static void check_same_size(const bytes_view a, const bytes_view b) {
+        if (a.size() != b.size())
+            throw std::invalid_argument("bytes are NOT the same length");
+    }
+
+    static uint64_t count_records(const bytes_view records, const bytes_view query) {
+        if (query.empty())
+            throw std::invalid_argument("`elem_to_compare` size must be >0");
+        if (records.size() % query.size() != 0)
+            throw std::invalid_argument("`array_of_elems` size must be multiplier of `elem_to_compare`");
+        return records.size() / query.size();
+    }
+
+    // Kernels take signed thresholds, every distance fits far below INT64_MAX.
+    static int64_t clamp(const uint64_t max_dist) {
+        return max_dist > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)max_dist;
+    }
+
+    template <std::size_t Bytes>
+    detail::hamming_distance_bytes_fn fixed_kernel() const {
+        static_assert(Bytes > 0, "records must not be empty");
+        if constexpr (Bytes % 8 == 0 && Bytes / 8 <= detail::FIXED_WIDTH_MAX_WORDS)
+            return table->hamming_distance_words[Bytes / 8 - 1];
+        else
+            return table->hamming_distance_bytes;
+    }
+
+    const detail::hexhamming_kernels* table;
+};
+
+}  // namespace hexhamming
+
+#endif  //HEXHAMMING_HPP
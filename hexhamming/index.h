@@ -0,0 +1,457 @@
+#ifndef HEXHAMMING_INDEX_H
+#define HEXHAMMING_INDEX_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#if defined(_MSC_VER)
+    #include <malloc.h>
+#endif
+#if defined(__linux__)
+    #include <sys/mman.h>
+#endif
+
+#include "kernels.h"
+#include "thread_pool.h"
+
+using hexhamming::detail::bytes_kernel_for_length;
+using hexhamming::detail::find_within_dist;
+using hexhamming::detail::hamming_distance_bytes_fn;
+using hexhamming::detail::hexhamming_kernels;
+
+#define INDEX_ALIGNMENT 64
+#define HUGE_PAGE_SIZE  (2ull << 20)
+
+static inline void* hexhamming_aligned_alloc(size_t size) {
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, INDEX_ALIGNMENT);
+#else
+    void *memory = NULL;
+    if (posix_memalign(&memory, INDEX_ALIGNMENT, size) != 0)
+        return NULL;
+    return memory;
+#endif
+}
+
+static inline void hexhamming_aligned_free(void *memory) {
+#if defined(_MSC_VER)
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+#if defined(__linux__)
+    static inline size_t storage_mapping_size(const size_t size) {
+        return (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+#endif
+
+/**
+ * Allocates record storage. On Linux blocks of at least one huge page are mapped directly: with
+ * reserved 2 MB huge pages (MAP_HUGETLB) if there are any, otherwise marked for transparent huge
+ * pages. Mapped pages are not touched here, they land on the NUMA node of the thread writing first.
+ */
+static void* hexhamming_storage_alloc(const size_t size) {
+#if defined(__linux__)
+    if (size >= HUGE_PAGE_SIZE) {
+        const size_t mapping_size = storage_mapping_size(size);
+        void *memory = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+            return memory;
+        memory = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return NULL;
+    #if defined(MADV_HUGEPAGE)
+        madvise(memory, mapping_size, MADV_HUGEPAGE);
+    #endif
+        return memory;
+    }
+#endif
+    return hexhamming_aligned_alloc(size);
+}
+
+static void hexhamming_storage_free(void *memory, const size_t size) {
+#if defined(__linux__)
+    if (size >= HUGE_PAGE_SIZE) {
+        munmap(memory, storage_mapping_size(size));
+        return;
+    }
+#endif
+    hexhamming_aligned_free(memory);
+}
+
+// Frees storage from hexhamming_storage_alloc, lets std::unique_ptr own it.
+struct hexhamming_storage_deleter {
+    size_t size;
+
+    void operator()(uint8_t *memory) const {
+        hexhamming_storage_free(memory, size);
+    }
+};
+
+/**
+ * Writes `memory` from a worker pinned to NUMA `node`, so the kernel places its pages there.
+ * Nothing to do on machines with a single node.
+ */
+static void first_touch_on_node(uint8_t *memory, const size_t size, const size_t node) {
+    if (numa_node_count() < 2)
+        return;
+    std::mutex mutex;
+    std::condition_variable touched;
+    bool done = false;
+    hexhamming_thread_pool::instance().submit_to_node(node, [&] {
+        memset(memory, 0, size);
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        touched.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    touched.wait(lock, [&done] { return done; });
+}
+
+/**
+ * Block of records with fixed capacity. Records are only appended (and only to the last segment
+ * of an index), the number of written records is published with release semantic, so readers
+ * may scan a segment while it is being filled. Deleted records are marked in a tombstone bitmap.
+ */
+struct hexhamming_segment {
+    const uint64_t elem_size;
+    const uint64_t capacity;
+    const size_t node;
+    uint8_t *records;
+    uint64_t *ids;
+    std::atomic<uint64_t> *tombstones;
+    std::atomic<uint64_t> size;
+    std::atomic<uint64_t> deleted;
+
+    hexhamming_segment(const uint64_t elem_size, const uint64_t capacity, const size_t node)
+        : elem_size(elem_size), capacity(capacity), node(node), size(0), deleted(0) {
+        // owned by unique_ptr until nothing can throw anymore
+        std::unique_ptr<uint8_t, hexhamming_storage_deleter> own_records(
+            (uint8_t*)hexhamming_storage_alloc(elem_size * capacity), hexhamming_storage_deleter{elem_size * capacity});
+        if (!own_records)
+            throw std::bad_alloc();
+        std::unique_ptr<uint64_t[]> own_ids(new uint64_t[capacity]);
+        std::unique_ptr<std::atomic<uint64_t>[]> own_tombstones(new std::atomic<uint64_t>[(capacity + 63) / 64]);
+        for (uint64_t i = 0; i < (capacity + 63) / 64; i++)
+            own_tombstones[i].store(0, std::memory_order_relaxed);
+        first_touch_on_node(own_records.get(), elem_size * capacity, node);
+        records = own_records.release();
+        ids = own_ids.release();
+        tombstones = own_tombstones.release();
+    }
+
+    ~hexhamming_segment() {
+        hexhamming_storage_free(records, elem_size * capacity);
+        delete[] ids;
+        delete[] tombstones;
+    }
+
+    hexhamming_segment(const hexhamming_segment&) = delete;
+    hexhamming_segment& operator=(const hexhamming_segment&) = delete;
+
+    // Marks record as deleted, returns false if it was already deleted.
+    bool mark_deleted(const uint64_t position) {
+        const uint64_t bit = 1ull << (position % 64);
+        if (tombstones[position / 64].fetch_or(bit, std::memory_order_relaxed) & bit)
+            return false;
+        deleted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Position of record with `id` or -1.
+    int64_t find(const uint64_t id) const {
+        uint64_t low = 0, high = size.load(std::memory_order_acquire);
+        while (low < high) {
+            const uint64_t middle = low + (high - low) / 2;
+            if (ids[middle] < id)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if (low < size.load(std::memory_order_acquire) && ids[low] == id)
+            return (int64_t)low;
+        return -1;
+    }
+};
+
+typedef std::vector<std::shared_ptr<hexhamming_segment>> hexhamming_segments;
+
+/**
+ * Mutable collection of equally sized records, each with an id assigned on append.
+ * Ids grow with every append and records keep their order, so a search returns the smallest
+ * matching id, the same way `check_bytes_arrays_within_dist` returns the first matching index.
+ *
+ * Appends, deletes, searches and compaction may run concurrently from different threads.
+ * A search scans the segments which existed when it started; compaction builds new segments
+ * without blocking anyone and swaps them in under a short lock.
+ *
+ * Segments are spread round-robin over NUMA nodes, a parallel search scans every segment with
+ * workers of the node holding it.
+ */
+class hexhamming_index {
+public:
+    hexhamming_index(const uint64_t elem_size, const uint64_t segment_capacity)
+        : elem_size(elem_size), segment_capacity(segment_capacity), next_id(0) {}
+
+    uint64_t get_elem_size() const {
+        return elem_size;
+    }
+
+    /**
+     * Appends `count` records. New segments are allocated and first touched without holding the
+     * lock searches take, appends are serialized by their own lock.
+     *
+     * @return      id of the first appended record, next records have consecutive ids
+     */
+    uint64_t append(const uint8_t *records, uint64_t count) {
+        std::lock_guard<std::mutex> append_lock(append_mutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        const uint64_t first_id = next_id;
+        while (count > 0) {
+            if (segments.empty() || is_full(*segments.back())) {
+                const size_t ordinal = segments.size();
+                lock.unlock();
+                std::shared_ptr<hexhamming_segment> segment = make_segment(ordinal);
+                lock.lock();
+                if (segments.empty() || is_full(*segments.back()))
+                    segments.push_back(std::move(segment));
+            }
+            hexhamming_segment &tail = *segments.back();
+            const uint64_t size = tail.size.load(std::memory_order_relaxed);
+            uint64_t chunk = tail.capacity - size;
+            if (chunk > count)
+                chunk = count;
+            memcpy(tail.records + size * elem_size, records, chunk * elem_size);
+            for (uint64_t i = 0; i < chunk; i++)
+                tail.ids[size + i] = next_id++;
+            tail.size.store(size + chunk, std::memory_order_release);
+            records += chunk * elem_size;
+            count -= chunk;
+        }
+        return first_id;
+    }
+
+    /**
+     * Marks record with `id` as deleted.
+     *
+     * @return      false if there is no such record or it was already deleted
+     */
+    bool remove(const uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // segments are ordered by ids, find the last one starting not after `id`
+        size_t low = 0, high = segments.size();
+        while (low < high) {
+            const size_t middle = low + (high - low) / 2;
+            if (segments[middle]->ids[0] <= id)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if (low == 0)
+            return false;
+        hexhamming_segment &segment = *segments[low - 1];
+        const int64_t position = segment.find(id);
+        if (position < 0)
+            return false;
+        return segment.mark_deleted((uint64_t)position);
+    }
+
+    /**
+     * Returns id of the first live record within `max_dist` of `query` or -1.
+     */
+    int64_t search(const uint8_t *query, const int64_t max_dist, const hexhamming_kernels *kernels) const {
+        const hexhamming_segments snapshot = get_segments();
+        for (const std::shared_ptr<hexhamming_segment> &segment : snapshot) {
+            const int64_t position = search_segment(*segment, query, max_dist, kernels);
+            if (position >= 0)
+                return (int64_t)segment->ids[position];
+        }
+        return -1;
+    }
+
+    /**
+     * Same result as `search`, but segments are scanned by pool workers, each on the NUMA node
+     * holding the segment. Workers of a node take its segments in order and stop as soon as a match
+     * was found in an earlier segment. Must not be called from a pool worker.
+     */
+    int64_t search_parallel(const uint8_t *query, const int64_t max_dist, const hexhamming_kernels *kernels) const {
+        const hexhamming_segments snapshot = get_segments();
+        if (snapshot.size() < 2)
+            return search(query, max_dist, kernels);
+
+        hexhamming_thread_pool &pool = hexhamming_thread_pool::instance();
+        std::vector<std::vector<size_t>> node_segments(pool.nodes());
+        for (size_t s = 0; s < snapshot.size(); s++)
+            node_segments[snapshot[s]->node % pool.nodes()].push_back(s);
+        std::unique_ptr<std::atomic<size_t>[]> next_segment(new std::atomic<size_t>[pool.nodes()]);
+        std::vector<int64_t> positions(snapshot.size(), -1);
+        std::atomic<size_t> first_match(SIZE_MAX);
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t running = 0;
+
+        for (size_t node = 0; node < pool.nodes(); node++) {
+            next_segment[node].store(0, std::memory_order_relaxed);
+            size_t tasks = pool.workers_on_node(node);
+            if (tasks > node_segments[node].size())
+                tasks = node_segments[node].size();
+            running += tasks;
+        }
+        for (size_t node = 0; node < pool.nodes(); node++) {
+            const std::vector<size_t> &own_segments = node_segments[node];
+            size_t tasks = pool.workers_on_node(node);
+            if (tasks > own_segments.size())
+                tasks = own_segments.size();
+            for (size_t t = 0; t < tasks; t++)
+                pool.submit_to_node(node, [&, node] {
+                    for (;;) {
+                        const size_t k = next_segment[node].fetch_add(1, std::memory_order_relaxed);
+                        if (k >= own_segments.size() || own_segments[k] > first_match.load(std::memory_order_relaxed))
+                            break;
+                        const size_t s = own_segments[k];
+                        const int64_t position = search_segment(*snapshot[s], query, max_dist, kernels);
+                        if (position < 0)
+                            continue;
+                        positions[s] = position;
+                        size_t current = first_match.load(std::memory_order_relaxed);
+                        while (s < current && !first_match.compare_exchange_weak(current, s))
+                            ;
+                        break;
+                    }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (--running == 0)
+                        finished.notify_one();
+                });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&running] { return running == 0; });
+
+        const size_t s = first_match.load(std::memory_order_relaxed);
+        if (s == SIZE_MAX)
+            return -1;
+        return (int64_t)snapshot[s]->ids[positions[s]];
+    }
+
+    // Number of live records.
+    uint64_t size() const {
+        uint64_t count = 0;
+        for (const std::shared_ptr<hexhamming_segment> &segment : get_segments())
+            count += segment->size.load(std::memory_order_acquire) -
+                     segment->deleted.load(std::memory_order_relaxed);
+        return count;
+    }
+
+    /**
+     * Merges all segments except the one receiving appends into full segments without deleted records.
+     * Deletes that happen while new segments are built are carried over when they are swapped in.
+     */
+    void compact() {
+        std::lock_guard<std::mutex> compaction_lock(compaction_mutex);
+        hexhamming_segments old_segments = get_segments();
+        if (old_segments.size() < 2)
+            return;
+        old_segments.pop_back();
+
+        // copy live records, remember where every old record went
+        hexhamming_segments new_segments;
+        std::vector<std::vector<uint64_t>> moved_to(old_segments.size());
+        std::vector<std::vector<uint64_t>> seen_tombstones(old_segments.size());
+        uint64_t new_position = 0;
+        for (size_t s = 0; s < old_segments.size(); s++) {
+            const hexhamming_segment &old_segment = *old_segments[s];
+            const uint64_t size = old_segment.size.load(std::memory_order_acquire);
+            moved_to[s].assign(size, UINT64_MAX);
+            for (uint64_t w = 0; w < (size + 63) / 64; w++)
+                seen_tombstones[s].push_back(old_segment.tombstones[w].load(std::memory_order_relaxed));
+            for (uint64_t i = 0; i < size; i++) {
+                if ((seen_tombstones[s][i / 64] >> (i % 64)) & 1)
+                    continue;
+                if (new_segments.empty() || is_full(*new_segments.back()))
+                    new_segments.push_back(make_segment(new_segments.size()));
+                hexhamming_segment &target = *new_segments.back();
+                const uint64_t target_size = target.size.load(std::memory_order_relaxed);
+                memcpy(target.records + target_size * elem_size, old_segment.records + i * elem_size, elem_size);
+                target.ids[target_size] = old_segment.ids[i];
+                target.size.store(target_size + 1, std::memory_order_relaxed);
+                moved_to[s][i] = new_position++;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t s = 0; s < old_segments.size(); s++) {
+            const hexhamming_segment &old_segment = *old_segments[s];
+            for (uint64_t w = 0; w < seen_tombstones[s].size(); w++) {
+                uint64_t deleted_meanwhile = old_segment.tombstones[w].load(std::memory_order_relaxed) &
+                                             ~seen_tombstones[s][w];
+                for (uint64_t bit = 0; deleted_meanwhile != 0; bit++, deleted_meanwhile >>= 1)
+                    if (deleted_meanwhile & 1) {
+                        const uint64_t position = moved_to[s][w * 64 + bit];
+                        new_segments[position / segment_capacity]->mark_deleted(position % segment_capacity);
+                    }
+            }
+        }
+        for (std::shared_ptr<hexhamming_segment> &segment : new_segments)
+            segment->size.store(segment->size.load(std::memory_order_relaxed), std::memory_order_release);
+        // only compaction changes segments before the tail, so the prefix is still `old_segments`
+        hexhamming_segments merged(new_segments);
+        merged.insert(merged.end(), segments.begin() + old_segments.size(), segments.end());
+        segments.swap(merged);
+    }
+
+private:
+    std::shared_ptr<hexhamming_segment> make_segment(const size_t ordinal) const {
+        return std::make_shared<hexhamming_segment>(elem_size, segment_capacity, ordinal % numa_node_count());
+    }
+
+    bool is_full(const hexhamming_segment &segment) const {
+        return segment.size.load(std::memory_order_relaxed) == segment.capacity;
+    }
+
+    hexhamming_segments get_segments() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return segments;
+    }
+
+    /**
+     * Position of first live record of segment within `max_dist` or -1. Tombstones are tested
+     * 64 records at a time, fully deleted words are skipped without touching their records.
+     */
+    int64_t search_segment(const hexhamming_segment &segment, const uint8_t *query, const int64_t max_dist,
+                           const hexhamming_kernels *kernels) const {
+        const hamming_distance_bytes_fn distance = bytes_kernel_for_length(kernels, elem_size);
+        const uint64_t size = segment.size.load(std::memory_order_acquire);
+        for (uint64_t first = 0; first < size; first += 64) {
+            uint64_t live = ~segment.tombstones[first / 64].load(std::memory_order_relaxed);
+            if (size - first < 64)
+                live &= (1ull << (size - first)) - 1;
+            if (live == UINT64_MAX) {
+                const int64_t position = find_within_dist(kernels, segment.records + first * elem_size, 64,
+                                                          query, elem_size, max_dist);
+                if (position >= 0)
+                    return (int64_t)first + position;
+                continue;
+            }
+            for (uint64_t i = first; live != 0; i++, live >>= 1)
+                if ((live & 1) && distance(segment.records + i * elem_size, query, elem_size, max_dist) == 1)
+                    return (int64_t)i;
+        }
+        return -1;
+    }
+
+    const uint64_t elem_size;
+    const uint64_t segment_capacity;
+    uint64_t next_id;
+    hexhamming_segments segments;
+    mutable std::mutex mutex;
+    std::mutex append_mutex;
+    std::mutex compaction_mutex;
+};
+
+#endif  //HEXHAMMING_INDEX_H
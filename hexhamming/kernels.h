@@ -0,0 +1,2030 @@
+#ifndef HEXHAMMING_KERNELS_H
+#define HEXHAMMING_KERNELS_H
+
+/* Kernels and kernel tables behind hexhamming.hpp, all in namespace hexhamming::detail. The only
+   macros left defined are the HEXHAMMING_* feature tests (HEXHAMMING_X86_64, HEXHAMMING_HAVE_AVX512,
+   HEXHAMMING_HAVE_NATIVE_POPCNT, ...), helper macros are undefined at the end. */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__has_builtin)
+    #define HEXHAMMING_HAS_BUILTIN(x) __has_builtin(x)
+#else
+    #define HEXHAMMING_HAS_BUILTIN(x) 0
+#endif
+
+#if defined(__has_attribute)
+    #define HEXHAMMING_HAS_ATTRIBUTE(x) __has_attribute(x)
+#else
+    #define HEXHAMMING_HAS_ATTRIBUTE(x) 0
+#endif
+
+#ifdef __GNUC__
+    #define HEXHAMMING_GNUC_PREREQ(x, y) \
+        (__GNUC__ > x || (__GNUC__ == x && __GNUC_MINOR__ >= y))
+#else
+    #define HEXHAMMING_GNUC_PREREQ(x, y) 0
+#endif
+
+#ifdef __clang__
+    #define HEXHAMMING_CLANG_PREREQ(x, y) \
+        (__clang_major__ > x || (__clang_major__ == x && __clang_minor__ >= y))
+#else
+    #define HEXHAMMING_CLANG_PREREQ(x, y) 0
+#endif
+
+#if (defined(__x86_64__) || defined(_M_X64))
+    #define HEXHAMMING_X86_64
+
+    #if HEXHAMMING_GNUC_PREREQ(4, 9)
+        #define HEXHAMMING_HAVE_AVX2
+    #endif
+    #if HEXHAMMING_GNUC_PREREQ(5, 0)
+        #define HEXHAMMING_HAVE_AVX512
+    #endif
+    #if defined(_MSC_VER) /* MSVC compatible compilers (Windows) */
+        #if defined(__clang__) /* clang-cl (LLVM 10 from 2020) requires /arch:AVX2(512) to enable vector instructions */
+            #if defined(__AVX2__)
+                #define HEXHAMMING_HAVE_AVX2
+            #endif
+            #if defined(__AVX512__)
+                #define HEXHAMMING_HAVE_AVX2
+                #define HEXHAMMING_HAVE_AVX512
+            #endif
+        #elif _MSC_VER >= 1910 /* MSVC 2017 or later does not require /arch:AVX2 or /arch:AVX512 */
+            #define HEXHAMMING_HAVE_AVX2
+            #define HEXHAMMING_HAVE_AVX512
+        #endif
+    #elif HEXHAMMING_CLANG_PREREQ(3, 8) && HEXHAMMING_HAS_ATTRIBUTE(target) && \
+          (!defined(__apple_build_version__) || __apple_build_version__ >= 8000000) /* Clang (Unix-like OSes) */
+        #define HEXHAMMING_HAVE_AVX2
+        #define HEXHAMMING_HAVE_AVX512
+    #endif
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #include <immintrin.h>
+        #include <nmmintrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+
+    #if (defined(HEXHAMMING_HAVE_AVX2) || defined(HEXHAMMING_HAVE_AVX512))
+        #define HEXHAMMING_X64_EXTRA
+    #endif
+#elif (defined(__clang__) && defined(__aarch64__))          //Apple M1
+    #define HEXHAMMING_ARM_EXTRA
+    #include <arm_neon.h>
+#endif
+
+#if defined(HEXHAMMING_X86_64) && (HEXHAMMING_GNUC_PREREQ(4, 2) || HEXHAMMING_CLANG_PREREQ(3, 0))
+    #define HEXHAMMING_HAVE_NATIVE_POPCNT
+#elif defined(HEXHAMMING_X86_64) && defined(_MSC_VER)
+    #define HEXHAMMING_HAVE_NATIVE_POPCNT
+#elif HEXHAMMING_GNUC_PREREQ(4, 2) || HEXHAMMING_HAS_BUILTIN(__builtin_popcount)
+    #define HEXHAMMING_HAVE_NATIVE_POPCNT
+#endif
+
+namespace hexhamming {
+namespace detail {
+
+#if defined(HEXHAMMING_X86_64)
+    // ecx flags
+    inline constexpr int CPU_SSE41  = 1 << 19;
+    inline constexpr int CPU_POPCNT = 1 << 23;
+    // ebx flags
+    inline constexpr int CPU_AVX2   = 1 << 5;
+    inline constexpr int CPU_AVX512 = 1 << 30;
+    // xgetbv bit flags
+    inline constexpr int XCR0_SSE = 1 << 1;
+    inline constexpr int XCR0_YMM = 1 << 2;
+    inline constexpr int XCR0_ZMM = 7 << 5;
+
+    inline void call_cpuid(int eax, int ecx, int* output)
+    {
+        #if defined(_MSC_VER)
+            __cpuidex(output, eax, ecx);
+        #else
+            int ebx = 0;
+            int edx = 0;
+            __asm__ ("cpuid;" : "+b" (ebx), "+a" (eax), "+c" (ecx), "=d" (edx));
+            output[0] = eax;
+            output[1] = ebx;
+            output[2] = ecx;
+            output[3] = edx;
+        #endif
+    }
+
+    inline int get_cpuid()
+    {
+        int flags = 0;
+        int cpu_flags[4];
+        call_cpuid(1, 0, cpu_flags);
+        if ((cpu_flags[2] & CPU_POPCNT) == CPU_POPCNT)
+            flags |= CPU_POPCNT;
+        if ((cpu_flags[2] & CPU_SSE41) == CPU_SSE41)
+            flags |= CPU_SSE41;
+        #if defined(HEXHAMMING_HAVE_AVX2) || defined(HEXHAMMING_HAVE_AVX512)
+            if ((cpu_flags[2] & (1 << 27)) != (1 << 27)) //check if processor state management supported
+                return flags;
+            int xcr0;
+            #if defined(_MSC_VER)
+                xcr0 = (int) _xgetbv(0);
+            #else
+                __asm__ ("xgetbv" : "=a" (xcr0) : "c" (0) : "%edx" );
+            #endif
+            if ((xcr0 & (XCR0_SSE | XCR0_YMM)) == (XCR0_SSE | XCR0_YMM))
+            {
+                call_cpuid(7, 0, cpu_flags);
+                if ((cpu_flags[1] & CPU_AVX2) == CPU_AVX2)
+                    flags |= CPU_AVX2;
+
+                if ((xcr0 & (XCR0_SSE | XCR0_YMM | XCR0_ZMM)) == (XCR0_SSE | XCR0_YMM | XCR0_ZMM))
+                {
+                    if ((cpu_flags[1] & CPU_AVX512) == CPU_AVX512)
+                        flags |= CPU_AVX512;
+                }
+            }
+        #endif
+        return flags;
+    }
+#elif defined(HEXHAMMING_ARM_EXTRA)
+    inline constexpr int CPU_POPCNT = 0;                    //This CPU supports popcnt.
+    inline constexpr int CPU_AVX2   = 0;                    //This CPU supports extra algorithms.
+#elif defined(__aarch64__)                                  //ARM8 with normal embedded Neon module.
+    inline constexpr int CPU_POPCNT = 0;
+    inline constexpr int CPU_AVX2   = (int)0xFFFFFFFF;      //Temporary: disabled, on emulator extra funcs fails.
+#elif defined(__ARM_NEON)                                   //ARM7 possibly with Neon, but in that CPU it is very slow.
+    inline constexpr int CPU_POPCNT = 0;
+    inline constexpr int CPU_AVX2   = (int)0xFFFFFFFF;
+#else                                                       //Other ARM CPU.
+    inline constexpr int CPU_POPCNT = (int)0xFFFFFFFF;
+    inline constexpr int CPU_AVX2   = (int)0xFFFFFFFF;
+#endif
+
+
+/* hamming_distance_bytes__classic, hamming_distance_bytes__native, hamming_distance_bytes__extra:
+   If max_dist < 0, then return hamming distance between arrays.
+   If max_dist >= 0, then return 0 if difference bigger then max_dist, or 1 if difference less then max_dist. */
+
+/* SIMD kernels accumulate threshold mode in vector registers too and compare with max_dist only every
+   `threshold_check_interval` blocks, since a horizontal reduction costs more than several blocks. The first
+   blocks, which cannot exceed max_dist even with every bit different, are never checked, the rest about
+   THRESHOLD_CHECKS times per record, and the final sum exactly. */
+inline constexpr int THRESHOLD_CHECKS = 8;
+
+inline uint64_t threshold_check_interval(const uint64_t blocks) {
+    return blocks / THRESHOLD_CHECKS > 0 ? blocks / THRESHOLD_CHECKS : 1;
+}
+
+// Index of the block after which the first check is done.
+inline uint64_t threshold_first_check(const int64_t max_dist, const uint64_t block_bytes,
+                                      const uint64_t interval) {
+    return (uint64_t)max_dist / (block_bytes * 8) + interval;
+}
+
+/*------- arm7 or kvm64 -------*/
+            /* BYTES */
+inline uint64_t popcnt64__classic(uint64_t x) {
+    //http://en.wikipedia.org/wiki/Hamming_weight#Efficient_implementation
+    uint64_t m1 = 0x5555555555555555ll;
+    uint64_t m2 = 0x3333333333333333ll;
+    uint64_t m4 = 0x0F0F0F0F0F0F0F0Fll;
+    uint64_t h01 = 0x0101010101010101ll;
+    x -= (x >> 1) & m1;
+    x = (x & m2) + ((x >> 2) & m2);
+    x = (x + (x >> 4)) & m4;
+    return (x * h01) >> 56;
+}
+
+inline uint64_t hamming_distance_bytes__classic(const uint8_t* a, const uint8_t* b,
+                                                const uint64_t length, const int64_t max_dist) {
+    uint64_t difference = 0;
+    uint64_t i = 0;
+    if (max_dist < 0)
+    {
+        if (length > 8)
+            for (; i < length - length % 8; i += 8)
+                difference += popcnt64__classic(*(size_t*)(a + i) ^ *(size_t*)(b + i));
+        for (; i < length; i++)
+            difference += popcnt64__classic(a[i] ^ b[i]);
+        return difference;
+    }
+    else
+    {
+        if (length > 8)
+            for (; i < length - length % 8; i += 8)
+            {
+                difference += popcnt64__classic(*(size_t*)(a + i) ^ *(size_t*)(b + i));
+                if (difference > (uint64_t)max_dist)
+                    return 0;
+            }
+        for (; i < length; i++)
+        {
+            difference += popcnt64__classic(a[i] ^ b[i]);
+            if (difference > (uint64_t)max_dist)
+                return 0;
+        }
+        return 1;
+    }
+}
+
+            /* STRINGS */
+/**
+ * An array of size 16 containing the XOR result of
+ * two numbers between 0 and 15 (i.e., '0' - 'F').
+ */
+inline constexpr unsigned char LOOKUP[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+/**
+ * Returns the hamming distance of the binary between two hexadecimal strings
+ * of the same length.
+ *
+ * @param a    hexadecimal char array
+ * @param b    hexadecimal char array
+ * @param string_length length of `a` and `b`
+ * @return      the number of bits different between the hexadecimal strings
+ */
+inline uint64_t hamming_distance_loop_string(const char* a, const char* b, const uint64_t string_length) {
+    uint64_t result = 0;
+    int val1, val2;
+    for (uint64_t i = 0; i < string_length; ++i) {
+        // Convert the hex ascii char to its actual hexadecimal value
+        // e.g., '0' = 0, 'A' = 10, etc.
+        // Note: this is case INSENSITIVE
+        // Also note:
+        //   * 65 = 'A'
+        //   * -55 = -65 + 10
+        val1 = (a[i] > '9') ? (a[i] &~ 0x20) - 55: (a[i] - '0');
+        val2 = (b[i] > '9') ? (b[i] &~ 0x20) - 55: (b[i] - '0');
+
+        // check to make sure all characters are valid
+        // hexadecimal in both strings
+        if (val1 > 15 || val1 < 0 || val2 > 15 || val2 < 0) {
+            return UINT64_MAX;
+        }
+
+        result += LOOKUP[val1 ^ val2];
+    }
+    return result;
+}
+
+
+/*------- SSE4.1 -------*/
+#ifdef HEXHAMMING_X86_64
+            /* BYTES */
+    // Nibble lookup popcount, SSE4.1 table is picked for CPUs without POPCNT instruction.
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline __m128i popcnt128_lanes__sse(__m128i n) {
+        const __m128i mask = _mm_set1_epi8(0x0F);
+        const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m128i lo = _mm_shuffle_epi8(table, _mm_and_si128(n, mask));
+        const __m128i hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(n, 4), mask));
+        return _mm_sad_epu8(_mm_add_epi8(lo, hi), _mm_setzero_si128());
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline uint64_t reduce128__sse(__m128i sums) {
+        return (uint64_t)_mm_cvtsi128_si64(sums) + (uint64_t)_mm_extract_epi64(sums, 1);
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline int64_t popcnt128__sse(__m128i n) {
+        return (int64_t)reduce128__sse(popcnt128_lanes__sse(n));
+    }
+
+    #define SSE_ITERATION { \
+            const __m128i a16 = _mm_loadu_si128((__m128i *)&a[i]); \
+            const __m128i b16 = _mm_loadu_si128((__m128i *)&b[i]); \
+            const __m128i xor_result = _mm_xor_si128(a16, b16); \
+            const __m128i lo  = _mm_and_si128(xor_result, sse_popcount_mask); \
+            const __m128i hi  = _mm_and_si128(_mm_srli_epi16(xor_result, 4), sse_popcount_mask); \
+            const __m128i cnt_low = _mm_shuffle_epi8(sse_popcount_table, lo); \
+            const __m128i cnt_high = _mm_shuffle_epi8(sse_popcount_table, hi); \
+            local = _mm_add_epi8(local, cnt_low); \
+            local = _mm_add_epi8(local, cnt_high); \
+            i += 16; \
+        }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline uint64_t hamming_distance_bytes__sse(const uint8_t* a, const uint8_t* b,
+                                                const uint64_t length, const int64_t max_dist) {
+        uint64_t i = 0;
+        uint64_t difference = 0;
+        if (max_dist < 0)
+        {
+            if (length > 16)
+            {
+                const __m128i sse_popcount_mask = _mm_set1_epi8(0x0F);
+                const __m128i sse_popcount_table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+                __m128i sse_difference = _mm_setzero_si128();
+                while (i + 16 * 4 <= length)
+                {
+                    __m128i local = _mm_setzero_si128();
+                    SSE_ITERATION SSE_ITERATION SSE_ITERATION SSE_ITERATION
+                    sse_difference = _mm_add_epi64(sse_difference, _mm_sad_epu8(local, _mm_setzero_si128()));
+                }
+                __m128i local = _mm_setzero_si128();
+                while (i + 16 <= length)
+                    SSE_ITERATION
+                sse_difference = _mm_add_epi64(sse_difference, _mm_sad_epu8(local, _mm_setzero_si128()));
+                difference = (uint64_t)(_mm_extract_epi64(sse_difference, 0));
+                difference += (uint64_t)(_mm_extract_epi64(sse_difference, 1));
+            }
+            for (; i < length; i++)
+                difference += popcnt64__classic(a[i] ^ b[i]);
+            return difference;
+        }
+        else
+        {
+            const uint64_t blocks = length / 16;
+            const uint64_t interval = threshold_check_interval(blocks);
+            uint64_t next_check = threshold_first_check(max_dist, 16, interval);
+            __m128i sse_difference = _mm_setzero_si128();
+            for (uint64_t block = 1; block <= blocks; block++, i += 16)
+            {
+                const __m128i a16 = _mm_loadu_si128((__m128i *)&a[i]);
+                const __m128i b16 = _mm_loadu_si128((__m128i *)&b[i]);
+                sse_difference = _mm_add_epi64(sse_difference, popcnt128_lanes__sse(_mm_xor_si128(a16, b16)));
+                if (block == next_check)
+                {
+                    if (reduce128__sse(sse_difference) > (uint64_t)max_dist)
+                        return 0;
+                    next_check += interval;
+                }
+            }
+            difference = reduce128__sse(sse_difference);
+            for (; i < length; i++)
+                difference += popcnt64__classic(a[i] ^ b[i]);
+            return difference <= (uint64_t)max_dist;
+        }
+    }
+    #undef SSE_ITERATION
+
+            /* STRINGS */
+    /**
+     * SSE4.1 implementation of bitwise hamming distance of hex strings
+     *
+     * @param a    hexadecimal char array
+     * @param b    hexadecimal char array
+     * @param string_length length of `a` and `b` (MUST be a multiple of 16)
+     * @return      the number of bits different between the hexadecimal strings
+     */
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline uint64_t hamming_distance_sse41_string(const char* a, const char* b, const uint64_t string_length) {
+        bool a_not_lt_0, a_not_gt_15, b_not_lt_0, b_not_gt_15;
+        uint64_t result = 0;
+
+        int64_t fifteen_less = string_length - 15;
+
+        __m128i zero = _mm_setzero_si128();
+        __m128i fifteen = _mm_set1_epi8(15);
+        __m128i xor_result, a_hex, b_hex;
+        for (int64_t i = 0; i < fifteen_less; i += 16) {
+            // Check if greater than 15 or less than 0
+
+            // load 16 chars from `a` and `b`
+            __m128i a16 = _mm_loadu_si128((__m128i *)&a[i]);
+            __m128i b16 = _mm_loadu_si128((__m128i *)&b[i]);
+
+            // Set up our masks for both branches of (x > '9') ? (x & ~0x20) - 55: x - '0'
+            __m128i subtract0vec = _mm_set1_epi8('0');  // ['0', '0', ...]
+            __m128i subtract55vec = _mm_set1_epi8(55);  // [55, 55, ...]
+            __m128i andvec = _mm_set1_epi8(~0x20);  // [-33, -33, ...]
+            __m128i isdigit_mask = _mm_set1_epi8('9');  // ['9', '9', ...]
+
+            // Perform the x > '9' comparison
+            __m128i a_cmp_mask = _mm_cmpgt_epi8(a16, isdigit_mask);
+            __m128i b_cmp_mask = _mm_cmpgt_epi8(b16, isdigit_mask);
+
+            // Compute for both branches
+
+            // x > '9'
+
+            // tmp = x & ~0x20
+            __m128i a_letter = _mm_and_si128(a16, andvec);
+            __m128i b_letter = _mm_and_si128(b16, andvec);
+
+            // tmp - 55
+            __m128i a_letter_normalized = _mm_sub_epi8(a_letter, subtract55vec);
+            __m128i b_letter_normalized = _mm_sub_epi8(b_letter, subtract55vec);
+
+            // x <= '9'
+
+            // x - '0'
+            __m128i a_digit_normalized = _mm_sub_epi8(a16, subtract0vec);
+            __m128i b_digit_normalized = _mm_sub_epi8(b16, subtract0vec);
+
+            // Put the ternary operator together
+            // Note: if result in _mm_cmpgt_ps is a 1, it means it's > '9'
+            a_hex = _mm_blendv_epi8(a_digit_normalized, a_letter_normalized, a_cmp_mask);
+            b_hex = _mm_blendv_epi8(b_digit_normalized, b_letter_normalized, b_cmp_mask);
+
+            // Greater than 15?
+            __m128i a15 = _mm_cmpgt_epi8(a_hex, fifteen);
+            __m128i b15 = _mm_cmpgt_epi8(b_hex, fifteen);
+
+            // Less than 0?
+            __m128i a0 = _mm_cmplt_epi16(a_hex, zero);
+            __m128i b0 = _mm_cmplt_epi16(b_hex, zero);
+
+            a_not_gt_15 = _mm_testz_si128(a15, a15);
+            b_not_gt_15 = _mm_testz_si128(b15, b15);
+            a_not_lt_0 = _mm_testz_si128(a0, a0);
+            b_not_lt_0 = _mm_testz_si128(b0, b0);
+
+            // If out of bounds, quit
+            if (!(a_not_lt_0 && a_not_gt_15 && b_not_lt_0 && b_not_gt_15)) {
+                return UINT64_MAX;
+            }
+
+            // Do the XOR
+            xor_result = _mm_xor_si128(a_hex, b_hex);
+
+            // Store the results
+            result += popcnt128__sse(xor_result);
+        }
+        return result;
+    }
+
+    /**
+     * Returns the hamming distance of the binary between two hexadecimal strings
+     * of the same length.
+     *
+     * @param a    hexadecimal char array
+     * @param b    hexadecimal char array
+     * @param string_length length of `a` and `b`
+     * @return      the number of bits different between the hexadecimal strings
+     */
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline uint64_t hamming_distance_string__sse(const char* a, const char* b, const uint64_t string_length) {
+        uint64_t result = hamming_distance_sse41_string(a, b, string_length);
+        if (result == UINT64_MAX) {
+            return result;
+        }
+
+        char mod16 = string_length & 15;
+        if (mod16 != 0) {
+            int64_t fifteen_less = string_length - mod16;
+            uint64_t start_index = fifteen_less >= 0 ? fifteen_less : 0;
+            uint64_t dist = hamming_distance_loop_string(&a[start_index], &b[start_index], mod16);
+            if (dist == UINT64_MAX) {
+                return dist;
+            } else {
+                result += dist;
+            }
+        }
+        return result;
+    }
+#endif
+
+
+
+/*------- Native popcnt64 -------*/
+#if defined(HEXHAMMING_X86_64) && (HEXHAMMING_GNUC_PREREQ(4, 2) || HEXHAMMING_CLANG_PREREQ(3, 0))
+     inline uint64_t popcnt64__native(uint64_t x) {
+         __asm__ ("popcnt %1, %0" : "=r" (x) : "0" (x));
+         return x;
+     }
+#elif defined(HEXHAMMING_X86_64) && defined(_MSC_VER)
+    inline uint64_t popcnt64__native(uint64_t x) {
+        return _mm_popcnt_u64(x);
+    }
+#elif defined(HEXHAMMING_HAVE_NATIVE_POPCNT)
+    inline uint64_t popcnt64__native(uint64_t x) {
+        return (uint64_t) __builtin_popcountll(x);
+    }
+#endif
+#ifdef HEXHAMMING_HAVE_NATIVE_POPCNT
+    inline uint64_t hamming_distance_bytes__native(const uint8_t* a, const uint8_t* b,
+                                                   const uint64_t length, const int64_t max_dist) {
+        uint64_t difference = 0;
+        uint64_t i = 0;
+        if (max_dist < 0)
+        {
+            if (length > 8)
+                for (; i < length - length % 8; i += 8)
+                    difference += popcnt64__native(*(size_t*)(a + i) ^ *(size_t*)(b + i));
+            for (; i < length; i++)
+                difference += popcnt64__native(a[i] ^ b[i]);
+            return difference;
+        }
+        else
+        {
+            if (length > 8)
+                for (; i < length - length % 8; i += 8)
+                {
+                    difference += popcnt64__native(*(size_t*)(a + i) ^ *(size_t*)(b + i));
+                    if (difference > (uint64_t)max_dist)
+                        return 0;
+                }
+            for (; i < length; i++)
+            {
+                difference += popcnt64__native(a[i] ^ b[i]);
+                if (difference > (uint64_t)max_dist)
+                    return 0;
+            }
+            return 1;
+        }
+    }
+#endif
+
+
+
+/*------- AVX2 / Neon -------*/
+#if defined(HEXHAMMING_X64_EXTRA)
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline __m256i popcnt256_lanes__avx2(__m256i v) {
+         const __m256i lookup1 = _mm256_setr_epi8(
+            4, 5, 5, 6, 5, 6, 6, 7,
+            5, 6, 6, 7, 6, 7, 7, 8,
+            4, 5, 5, 6, 5, 6, 6, 7,
+            5, 6, 6, 7, 6, 7, 7, 8 );
+
+         const __m256i lookup2 = _mm256_setr_epi8(
+            4, 3, 3, 2, 3, 2, 2, 1,
+            3, 2, 2, 1, 2, 1, 1, 0,
+            4, 3, 3, 2, 3, 2, 2, 1,
+            3, 2, 2, 1, 2, 1, 1, 0 );
+
+        __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i popcnt1 = _mm256_shuffle_epi8(lookup1, lo);
+        __m256i popcnt2 = _mm256_shuffle_epi8(lookup2, hi);
+        return _mm256_sad_epu8(popcnt1, popcnt2);
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline uint64_t reduce256__avx2(__m256i r) {
+        return _mm256_extract_epi64(r, 0) + _mm256_extract_epi64(r, 1) +\
+                        _mm256_extract_epi64(r, 2) + _mm256_extract_epi64(r, 3);
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline uint64_t popcnt256__avx2(__m256i v) {
+        return reduce256__avx2(popcnt256_lanes__avx2(v));
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline uint64_t hamming_distance_bytes__extra(const uint8_t* a, const uint8_t* b,
+                                                  const uint64_t length, const int64_t max_dist) {
+        uint64_t difference = 0;
+        uint64_t i = 0;
+        if (max_dist < 0)
+        {
+            if (length > 32)
+                for (; i < length - length % 32; i += 32)
+                {
+                    __m256i a32 = _mm256_loadu_si256((__m256i *)&a[i]);
+                    __m256i b32 = _mm256_loadu_si256((__m256i *)&b[i]);
+                    difference += popcnt256__avx2(_mm256_xor_si256(a32, b32));
+                }
+            for (; i < length; i++)
+                difference += popcnt64__native(a[i] ^ b[i]);
+            return difference;
+        }
+        else
+        {
+            const uint64_t blocks = length / 32;
+            const uint64_t interval = threshold_check_interval(blocks);
+            uint64_t next_check = threshold_first_check(max_dist, 32, interval);
+            __m256i sum = _mm256_setzero_si256();
+            for (uint64_t block = 1; block <= blocks; block++, i += 32)
+            {
+                __m256i a32 = _mm256_loadu_si256((__m256i *)&a[i]);
+                __m256i b32 = _mm256_loadu_si256((__m256i *)&b[i]);
+                sum = _mm256_add_epi64(sum, popcnt256_lanes__avx2(_mm256_xor_si256(a32, b32)));
+                if (block == next_check)
+                {
+                    if (reduce256__avx2(sum) > (uint64_t)max_dist)
+                        return 0;
+                    next_check += interval;
+                }
+            }
+            difference = reduce256__avx2(sum);
+            for (; i < length; i++)
+                difference += popcnt64__native(a[i] ^ b[i]);
+            return difference <= (uint64_t)max_dist;
+        }
+    }
+#elif defined(HEXHAMMING_ARM_EXTRA)
+    inline uint64x2_t vpadalq(uint64x2_t sum, uint8x16_t t)
+    {
+        return vpadalq_u32(sum, vpaddlq_u16(vpaddlq_u8(t)));
+    }
+    inline uint64_t hamming_distance_bytes__extra(const uint8_t* a, const uint8_t* b,
+                                                  const uint64_t length, const int64_t max_dist) {
+        if (max_dist >= 0)
+            return hamming_distance_bytes__native(a, b, length, max_dist);   //This is faster on ARMs.
+        uint64_t difference = 0;
+        uint64_t i = 0;
+        uint64_t current_iter = 0;
+        uint64_t total_iters = length / 64;
+        if (total_iters >= 1)
+        {
+            uint64x2_t sum = vcombine_u64(vcreate_u64(0), vcreate_u64(0));
+            uint8x16_t zero = vcombine_u8(vcreate_u8(0), vcreate_u8(0));
+            do
+            {
+                uint8x16_t t0 = zero;
+                uint8x16_t t1 = zero;
+                uint8x16_t t2 = zero;
+                uint8x16_t t3 = zero;
+                uint64_t iter_limit = (current_iter + 31 < total_iters) ? current_iter + 31 : total_iters;
+                for (; current_iter < iter_limit; current_iter++) {
+                    uint8x16x4_t input_a = vld4q_u8(&a[i]);
+                    uint8x16x4_t input_b = vld4q_u8(&b[i]);
+                    i += 64;
+                    t0 = vaddq_u8(t0, vcntq_u8(veorq_u8(input_a.val[0], input_b.val[0])));
+                    t1 = vaddq_u8(t1, vcntq_u8(veorq_u8(input_a.val[1], input_b.val[1])));
+                    t2 = vaddq_u8(t2, vcntq_u8(veorq_u8(input_a.val[2], input_b.val[2])));
+                    t3 = vaddq_u8(t3, vcntq_u8(veorq_u8(input_a.val[3], input_b.val[3])));
+                }
+                sum = vpadalq(sum, t0);
+                sum = vpadalq(sum, t1);
+                sum = vpadalq(sum, t2);
+                sum = vpadalq(sum, t3);
+            }
+            while (current_iter < total_iters);
+            uint64_t tmp[2];
+            vst1q_u64(tmp, sum);
+            difference += tmp[0] + tmp[1];
+        }
+        for (; i < length; i++)
+            difference += popcnt64__native(a[i] ^ b[i]);
+        return difference;
+    }
+#else
+    inline uint64_t hamming_distance_bytes__extra(const uint8_t* a, const uint8_t* b,
+                                                  const uint64_t length, const int64_t max_dist) {
+        return 0;                                                      // We will never call this func.
+    }
+#endif
+
+
+
+/*------- Intersection / union popcounts (Tanimoto) -------*/
+/* and_or_popcount_bytes__classic, and_or_popcount_bytes__native, and_or_popcount_bytes__sse,
+   and_or_popcount_bytes__extra:
+   Single pass over both arrays, stores popcount(a & b) to `and_count` and popcount(a | b) to `or_count`. */
+
+inline void and_or_popcount_bytes__classic(const uint8_t* a, const uint8_t* b, const uint64_t length,
+                                           uint64_t* and_count, uint64_t* or_count) {
+    uint64_t count_and = 0, count_or = 0;
+    uint64_t i = 0;
+    if (length > 8)
+        for (; i < length - length % 8; i += 8)
+        {
+            const uint64_t a8 = *(size_t*)(a + i);
+            const uint64_t b8 = *(size_t*)(b + i);
+            count_and += popcnt64__classic(a8 & b8);
+            count_or += popcnt64__classic(a8 | b8);
+        }
+    for (; i < length; i++)
+    {
+        count_and += popcnt64__classic(a[i] & b[i]);
+        count_or += popcnt64__classic(a[i] | b[i]);
+    }
+    *and_count = count_and;
+    *or_count = count_or;
+}
+
+#ifdef HEXHAMMING_HAVE_NATIVE_POPCNT
+    inline void and_or_popcount_bytes__native(const uint8_t* a, const uint8_t* b, const uint64_t length,
+                                              uint64_t* and_count, uint64_t* or_count) {
+        uint64_t count_and = 0, count_or = 0;
+        uint64_t i = 0;
+        if (length > 8)
+            for (; i < length - length % 8; i += 8)
+            {
+                const uint64_t a8 = *(size_t*)(a + i);
+                const uint64_t b8 = *(size_t*)(b + i);
+                count_and += popcnt64__native(a8 & b8);
+                count_or += popcnt64__native(a8 | b8);
+            }
+        for (; i < length; i++)
+        {
+            count_and += popcnt64__native(a[i] & b[i]);
+            count_or += popcnt64__native(a[i] | b[i]);
+        }
+        *and_count = count_and;
+        *or_count = count_or;
+    }
+#endif
+
+#ifdef HEXHAMMING_X86_64
+    #define SSE_NIBBLE_POPCOUNT(local, value) { \
+            const __m128i lo  = _mm_and_si128(value, sse_popcount_mask); \
+            const __m128i hi  = _mm_and_si128(_mm_srli_epi16(value, 4), sse_popcount_mask); \
+            local = _mm_add_epi8(local, _mm_shuffle_epi8(sse_popcount_table, lo)); \
+            local = _mm_add_epi8(local, _mm_shuffle_epi8(sse_popcount_table, hi)); \
+        }
+    #define SSE_AND_OR_ITERATION { \
+            const __m128i a16 = _mm_loadu_si128((__m128i *)&a[i]); \
+            const __m128i b16 = _mm_loadu_si128((__m128i *)&b[i]); \
+            SSE_NIBBLE_POPCOUNT(local_and, _mm_and_si128(a16, b16)) \
+            SSE_NIBBLE_POPCOUNT(local_or, _mm_or_si128(a16, b16)) \
+            i += 16; \
+        }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline void and_or_popcount_bytes__sse(const uint8_t* a, const uint8_t* b, const uint64_t length,
+                                           uint64_t* and_count, uint64_t* or_count) {
+        uint64_t i = 0;
+        uint64_t count_and = 0, count_or = 0;
+        if (length > 16)
+        {
+            const __m128i sse_popcount_mask = _mm_set1_epi8(0x0F);
+            const __m128i sse_popcount_table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            __m128i sse_and = _mm_setzero_si128();
+            __m128i sse_or = _mm_setzero_si128();
+            while (i + 16 * 4 <= length)
+            {
+                __m128i local_and = _mm_setzero_si128();
+                __m128i local_or = _mm_setzero_si128();
+                SSE_AND_OR_ITERATION SSE_AND_OR_ITERATION SSE_AND_OR_ITERATION SSE_AND_OR_ITERATION
+                sse_and = _mm_add_epi64(sse_and, _mm_sad_epu8(local_and, _mm_setzero_si128()));
+                sse_or = _mm_add_epi64(sse_or, _mm_sad_epu8(local_or, _mm_setzero_si128()));
+            }
+            __m128i local_and = _mm_setzero_si128();
+            __m128i local_or = _mm_setzero_si128();
+            while (i + 16 <= length)
+                SSE_AND_OR_ITERATION
+            sse_and = _mm_add_epi64(sse_and, _mm_sad_epu8(local_and, _mm_setzero_si128()));
+            sse_or = _mm_add_epi64(sse_or, _mm_sad_epu8(local_or, _mm_setzero_si128()));
+            count_and = (uint64_t)(_mm_extract_epi64(sse_and, 0)) + (uint64_t)(_mm_extract_epi64(sse_and, 1));
+            count_or = (uint64_t)(_mm_extract_epi64(sse_or, 0)) + (uint64_t)(_mm_extract_epi64(sse_or, 1));
+        }
+        for (; i < length; i++)
+        {
+            count_and += popcnt64__classic(a[i] & b[i]);
+            count_or += popcnt64__classic(a[i] | b[i]);
+        }
+        *and_count = count_and;
+        *or_count = count_or;
+    }
+    #undef SSE_AND_OR_ITERATION
+    #undef SSE_NIBBLE_POPCOUNT
+#endif
+
+#if defined(HEXHAMMING_X64_EXTRA)
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline void and_or_popcount_bytes__extra(const uint8_t* a, const uint8_t* b, const uint64_t length,
+                                             uint64_t* and_count, uint64_t* or_count) {
+        uint64_t count_and = 0, count_or = 0;
+        uint64_t i = 0;
+        if (length > 32)
+        {
+            __m256i avx_and = _mm256_setzero_si256();
+            __m256i avx_or = _mm256_setzero_si256();
+            for (; i < length - length % 32; i += 32)
+            {
+                __m256i a32 = _mm256_loadu_si256((__m256i *)&a[i]);
+                __m256i b32 = _mm256_loadu_si256((__m256i *)&b[i]);
+                avx_and = _mm256_add_epi64(avx_and, popcnt256_lanes__avx2(_mm256_and_si256(a32, b32)));
+                avx_or = _mm256_add_epi64(avx_or, popcnt256_lanes__avx2(_mm256_or_si256(a32, b32)));
+            }
+            count_and = reduce256__avx2(avx_and);
+            count_or = reduce256__avx2(avx_or);
+        }
+        for (; i < length; i++)
+        {
+            count_and += popcnt64__native(a[i] & b[i]);
+            count_or += popcnt64__native(a[i] | b[i]);
+        }
+        *and_count = count_and;
+        *or_count = count_or;
+    }
+#elif defined(HEXHAMMING_ARM_EXTRA)
+    inline void and_or_popcount_bytes__extra(const uint8_t* a, const uint8_t* b, const uint64_t length,
+                                             uint64_t* and_count, uint64_t* or_count) {
+        uint64_t count_and = 0, count_or = 0;
+        uint64_t i = 0;
+        uint64_t current_iter = 0;
+        uint64_t total_iters = length / 16;
+        if (total_iters >= 1)
+        {
+            uint64x2_t sum_and = vcombine_u64(vcreate_u64(0), vcreate_u64(0));
+            uint64x2_t sum_or = vcombine_u64(vcreate_u64(0), vcreate_u64(0));
+            uint8x16_t zero = vcombine_u8(vcreate_u8(0), vcreate_u8(0));
+            do
+            {
+                uint8x16_t t_and = zero;
+                uint8x16_t t_or = zero;
+                uint64_t iter_limit = (current_iter + 31 < total_iters) ? current_iter + 31 : total_iters;
+                for (; current_iter < iter_limit; current_iter++) {
+                    uint8x16_t input_a = vld1q_u8(&a[i]);
+                    uint8x16_t input_b = vld1q_u8(&b[i]);
+                    i += 16;
+                    t_and = vaddq_u8(t_and, vcntq_u8(vandq_u8(input_a, input_b)));
+                    t_or = vaddq_u8(t_or, vcntq_u8(vorrq_u8(input_a, input_b)));
+                }
+                sum_and = vpadalq(sum_and, t_and);
+                sum_or = vpadalq(sum_or, t_or);
+            }
+            while (current_iter < total_iters);
+            uint64_t tmp[2];
+            vst1q_u64(tmp, sum_and);
+            count_and = tmp[0] + tmp[1];
+            vst1q_u64(tmp, sum_or);
+            count_or = tmp[0] + tmp[1];
+        }
+        for (; i < length; i++)
+        {
+            count_and += popcnt64__native(a[i] & b[i]);
+            count_or += popcnt64__native(a[i] | b[i]);
+        }
+        *and_count = count_and;
+        *or_count = count_or;
+    }
+#else
+    inline void and_or_popcount_bytes__extra(const uint8_t* a, const uint8_t* b, const uint64_t length,
+                                             uint64_t* and_count, uint64_t* or_count) {
+        and_or_popcount_bytes__classic(a, b, length, and_count, or_count);
+    }
+#endif
+
+
+
+/*------- AVX-512 -------*/
+/* hamming_distance_bytes__avx512, and_or_popcount_bytes__avx512:
+   Same contracts as the AVX2 kernels, 64 bytes per step; the tail is read with a masked load. */
+#if defined(HEXHAMMING_HAVE_AVX512)
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx512bw")))
+    #endif
+    inline __m512i popcnt512_lanes__avx512(__m512i v) {
+        // nibble popcounts 0..15 in every 128-bit lane
+        const __m512i table = _mm512_set_epi64(0x0403030203020201, 0x0302020102010100,
+                                               0x0403030203020201, 0x0302020102010100,
+                                               0x0403030203020201, 0x0302020102010100,
+                                               0x0403030203020201, 0x0302020102010100);
+        const __m512i mask = _mm512_set1_epi8(0x0F);
+        const __m512i lo = _mm512_shuffle_epi8(table, _mm512_and_si512(v, mask));
+        const __m512i hi = _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(v, 4), mask));
+        return _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512());
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx512bw")))
+    #endif
+    inline uint64_t reduce512__avx512(__m512i r) {
+        uint64_t lanes[8];
+        _mm512_storeu_si512((void*)lanes, r);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    }
+    inline __mmask64 tail_mask__avx512(const uint64_t remaining) {
+        return remaining >= 64 ? ~(__mmask64)0 : (((__mmask64)1 << remaining) - 1);
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx512bw")))
+    #endif
+    inline uint64_t hamming_distance_bytes__avx512(const uint8_t* a, const uint8_t* b,
+                                                   const uint64_t length, const int64_t max_dist) {
+        uint64_t i = 0;
+        if (max_dist < 0)
+        {
+            __m512i sum = _mm512_setzero_si512();
+            for (; i + 64 <= length; i += 64)
+            {
+                const __m512i a64 = _mm512_loadu_si512((const void*)&a[i]);
+                const __m512i b64 = _mm512_loadu_si512((const void*)&b[i]);
+                sum = _mm512_add_epi64(sum, popcnt512_lanes__avx512(_mm512_xor_si512(a64, b64)));
+            }
+            if (i < length)
+            {
+                const __mmask64 tail = tail_mask__avx512(length - i);
+                const __m512i a64 = _mm512_maskz_loadu_epi8(tail, &a[i]);
+                const __m512i b64 = _mm512_maskz_loadu_epi8(tail, &b[i]);
+                sum = _mm512_add_epi64(sum, popcnt512_lanes__avx512(_mm512_xor_si512(a64, b64)));
+            }
+            return reduce512__avx512(sum);
+        }
+        else
+        {
+            const uint64_t blocks = (length + 63) / 64;
+            const uint64_t interval = threshold_check_interval(blocks);
+            uint64_t next_check = threshold_first_check(max_dist, 64, interval);
+            __m512i sum = _mm512_setzero_si512();
+            for (uint64_t block = 1; block <= blocks; block++, i += 64)
+            {
+                const __mmask64 tail = tail_mask__avx512(length - i);
+                const __m512i a64 = _mm512_maskz_loadu_epi8(tail, &a[i]);
+                const __m512i b64 = _mm512_maskz_loadu_epi8(tail, &b[i]);
+                sum = _mm512_add_epi64(sum, popcnt512_lanes__avx512(_mm512_xor_si512(a64, b64)));
+                if (block == next_check)
+                {
+                    if (reduce512__avx512(sum) > (uint64_t)max_dist)
+                        return 0;
+                    next_check += interval;
+                }
+            }
+            return reduce512__avx512(sum) <= (uint64_t)max_dist;
+        }
+    }
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx512bw")))
+    #endif
+    inline void and_or_popcount_bytes__avx512(const uint8_t* a, const uint8_t* b, const uint64_t length,
+                                              uint64_t* and_count, uint64_t* or_count) {
+        __m512i sum_and = _mm512_setzero_si512();
+        __m512i sum_or = _mm512_setzero_si512();
+        for (uint64_t i = 0; i < length; i += 64)
+        {
+            const __mmask64 tail = tail_mask__avx512(length - i);
+            const __m512i a64 = _mm512_maskz_loadu_epi8(tail, &a[i]);
+            const __m512i b64 = _mm512_maskz_loadu_epi8(tail, &b[i]);
+            sum_and = _mm512_add_epi64(sum_and, popcnt512_lanes__avx512(_mm512_and_si512(a64, b64)));
+            sum_or = _mm512_add_epi64(sum_or, popcnt512_lanes__avx512(_mm512_or_si512(a64, b64)));
+        }
+        *and_count = reduce512__avx512(sum_and);
+        *or_count = reduce512__avx512(sum_or);
+    }
+#endif
+
+
+
+/*------- Bit-sliced (transposed) layout -------*/
+/* Records are grouped in blocks of BITSLICE_BLOCK. Inside a block, bit `j` of every record is packed into
+   plane `j` of BITSLICE_PLANE_BYTES bytes (record `r` of the block is bit r % 8 of byte r / 8), so one plane
+   fills one AVX2 register. Distances of the whole block are accumulated vertically: every plane is XORed with
+   the broadcasted query bit and added into per-record counters stored as bit planes too.
+
+   bitsliced_within_dist__classic, bitsliced_within_dist__extra:
+   Return index of the first record with hamming distance <= max_dist or -1. */
+inline constexpr int BITSLICE_BLOCK = 256;
+inline constexpr int BITSLICE_PLANE_BYTES = BITSLICE_BLOCK / 8;
+inline constexpr int BITSLICE_MAX_COUNTER = 32;
+
+inline uint64_t bitsliced_size(const uint64_t number_of_elements, const uint64_t elem_size) {
+    return (number_of_elements + BITSLICE_BLOCK - 1) / BITSLICE_BLOCK * elem_size * 8 * BITSLICE_PLANE_BYTES;
+}
+
+/**
+ * Returns true if `size` is `bitsliced_size(number_of_elements, elem_size)`, checked by division so that
+ * counts whose size does not fit in 64 bits never match.
+ */
+inline bool is_bitsliced_size(const uint64_t size, const uint64_t number_of_elements, const uint64_t elem_size) {
+    const uint64_t blocks = (number_of_elements + BITSLICE_BLOCK - 1) / BITSLICE_BLOCK;
+    if (blocks == 0)
+        return size == 0;
+    const uint64_t block_size = size / blocks;
+    return size % blocks == 0 && block_size % (8 * BITSLICE_PLANE_BYTES) == 0 &&
+           block_size / (8 * BITSLICE_PLANE_BYTES) == elem_size;
+}
+
+/**
+ * Converts packed records (as used by `check_bytes_arrays_within_dist`) into the bit-sliced layout.
+ *
+ * @param array     packed records
+ * @param number_of_elements number of records in `array`
+ * @param elem_size size of one record in bytes
+ * @param out       zero filled output of `bitsliced_size(number_of_elements, elem_size)` bytes
+ */
+inline void bitslice_bytes_array(const uint8_t* array, const uint64_t number_of_elements,
+                                 const uint64_t elem_size, uint8_t* out) {
+    const uint64_t block_size = elem_size * 8 * BITSLICE_PLANE_BYTES;
+    for (uint64_t r = 0; r < number_of_elements; r++, array += elem_size) {
+        uint8_t* block = out + (r / BITSLICE_BLOCK) * block_size + (r % BITSLICE_BLOCK) / 8;
+        const uint8_t record_bit = (uint8_t)(1 << (r % 8));
+        for (uint64_t byte = 0; byte < elem_size; byte++) {
+            uint8_t value = array[byte];
+            for (uint64_t j = byte * 8; value != 0; j++, value >>= 1)
+                if (value & 1)
+                    block[j * BITSLICE_PLANE_BYTES] |= record_bit;
+        }
+    }
+}
+
+// Number of bit planes needed to hold counters from 0 to `bits`.
+inline int bitsliced_counter_planes(uint64_t bits) {
+    int planes = 0;
+    for (; bits != 0; bits >>= 1)
+        planes++;
+    return planes;
+}
+
+// Mask of valid records in 64 record word starting at `first` record.
+inline uint64_t bitsliced_valid_mask(const uint64_t first, const uint64_t number_of_elements) {
+    if (first >= number_of_elements)
+        return 0;
+    if (number_of_elements - first >= 64)
+        return UINT64_MAX;
+    return (1ull << (number_of_elements - first)) - 1;
+}
+
+inline uint64_t bitsliced_first_bit(uint64_t mask) {
+    uint64_t index = 0;
+    for (; (mask & 1) == 0; mask >>= 1)
+        index++;
+    return index;
+}
+
+inline void bitsliced_add__classic(uint64_t* counter, int level, const int planes, uint64_t x) {
+    for (; level < planes && x != 0; level++) {
+        const uint64_t carry = counter[level] & x;
+        counter[level] ^= x;
+        x = carry;
+    }
+}
+
+inline int64_t bitsliced_within_dist__classic(const uint8_t* sliced, const uint64_t number_of_elements,
+                                              const uint64_t elem_size, const uint8_t* query,
+                                              const uint64_t max_dist) {
+    const uint64_t bits = elem_size * 8;
+    if (max_dist >= bits)
+        return number_of_elements > 0 ? 0 : -1;
+    const int planes = bitsliced_counter_planes(bits);
+    const uint64_t block_size = bits * BITSLICE_PLANE_BYTES;
+    for (uint64_t first = 0; first < number_of_elements; first += BITSLICE_BLOCK, sliced += block_size)
+        for (uint64_t word = 0; word < BITSLICE_PLANE_BYTES / 8; word++) {
+            uint64_t counter[BITSLICE_MAX_COUNTER] = {0};
+            const uint8_t* plane = sliced + word * 8;
+            uint64_t j = 0;
+            // carry-save: three planes give a sum (weight 1) and a carry (weight 2)
+            for (; j + 3 <= bits; j += 3, plane += 3 * BITSLICE_PLANE_BYTES) {
+                const uint64_t x0 = *(uint64_t*)(plane) ^ (0 - (uint64_t)((query[j / 8] >> (j % 8)) & 1));
+                const uint64_t x1 = *(uint64_t*)(plane + BITSLICE_PLANE_BYTES) ^
+                                    (0 - (uint64_t)((query[(j + 1) / 8] >> ((j + 1) % 8)) & 1));
+                const uint64_t x2 = *(uint64_t*)(plane + 2 * BITSLICE_PLANE_BYTES) ^
+                                    (0 - (uint64_t)((query[(j + 2) / 8] >> ((j + 2) % 8)) & 1));
+                const uint64_t x01 = x0 ^ x1;
+                bitsliced_add__classic(counter, 0, planes, x01 ^ x2);
+                bitsliced_add__classic(counter, 1, planes, (x0 & x1) | (x01 & x2));
+            }
+            for (; j < bits; j++, plane += BITSLICE_PLANE_BYTES)
+                bitsliced_add__classic(counter, 0, planes,
+                                       *(uint64_t*)(plane) ^ (0 - (uint64_t)((query[j / 8] >> (j % 8)) & 1)));
+            // counter > max_dist, compared from the most significant plane
+            uint64_t greater = 0, equal = UINT64_MAX;
+            for (int k = planes - 1; k >= 0; k--) {
+                if ((max_dist >> k) & 1)
+                    equal &= counter[k];
+                else {
+                    greater |= equal & counter[k];
+                    equal &= ~counter[k];
+                }
+            }
+            const uint64_t within = ~greater & bitsliced_valid_mask(first + word * 64, number_of_elements);
+            if (within != 0)
+                return (int64_t)(first + word * 64 + bitsliced_first_bit(within));
+        }
+    return -1;
+}
+
+#if defined(HEXHAMMING_X64_EXTRA)
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline void bitsliced_add__avx2(__m256i* counter, int level, const int planes, __m256i x) {
+        for (; level < planes && !_mm256_testz_si256(x, x); level++) {
+            const __m256i carry = _mm256_and_si256(counter[level], x);
+            counter[level] = _mm256_xor_si256(counter[level], x);
+            x = carry;
+        }
+    }
+
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline int64_t bitsliced_within_dist__extra(const uint8_t* sliced, const uint64_t number_of_elements,
+                                                const uint64_t elem_size, const uint8_t* query,
+                                                const uint64_t max_dist) {
+        const uint64_t bits = elem_size * 8;
+        if (max_dist >= bits)
+            return number_of_elements > 0 ? 0 : -1;
+        const int planes = bitsliced_counter_planes(bits);
+        const uint64_t block_size = bits * BITSLICE_PLANE_BYTES;
+        for (uint64_t first = 0; first < number_of_elements; first += BITSLICE_BLOCK, sliced += block_size) {
+            __m256i counter[BITSLICE_MAX_COUNTER];
+            for (int k = 0; k < planes; k++)
+                counter[k] = _mm256_setzero_si256();
+            const uint8_t* plane = sliced;
+            uint64_t j = 0;
+            for (; j + 3 <= bits; j += 3, plane += 3 * BITSLICE_PLANE_BYTES) {
+                const __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)plane),
+                    _mm256_set1_epi64x(-(int64_t)((query[j / 8] >> (j % 8)) & 1)));
+                const __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)(plane + BITSLICE_PLANE_BYTES)),
+                    _mm256_set1_epi64x(-(int64_t)((query[(j + 1) / 8] >> ((j + 1) % 8)) & 1)));
+                const __m256i x2 = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)(plane + 2 * BITSLICE_PLANE_BYTES)),
+                    _mm256_set1_epi64x(-(int64_t)((query[(j + 2) / 8] >> ((j + 2) % 8)) & 1)));
+                const __m256i x01 = _mm256_xor_si256(x0, x1);
+                bitsliced_add__avx2(counter, 0, planes, _mm256_xor_si256(x01, x2));
+                bitsliced_add__avx2(counter, 1, planes,
+                                    _mm256_or_si256(_mm256_and_si256(x0, x1), _mm256_and_si256(x01, x2)));
+            }
+            for (; j < bits; j++, plane += BITSLICE_PLANE_BYTES)
+                bitsliced_add__avx2(counter, 0, planes, _mm256_xor_si256(_mm256_loadu_si256((__m256i *)plane),
+                                    _mm256_set1_epi64x(-(int64_t)((query[j / 8] >> (j % 8)) & 1))));
+            __m256i greater = _mm256_setzero_si256();
+            __m256i equal = _mm256_set1_epi64x(-1);
+            for (int k = planes - 1; k >= 0; k--) {
+                if ((max_dist >> k) & 1)
+                    equal = _mm256_and_si256(equal, counter[k]);
+                else {
+                    greater = _mm256_or_si256(greater, _mm256_and_si256(equal, counter[k]));
+                    equal = _mm256_andnot_si256(counter[k], equal);
+                }
+            }
+            // the whole block is rejected with one test
+            if (_mm256_testc_si256(greater, _mm256_set1_epi64x(-1)))
+                continue;
+            uint64_t words[4];
+            _mm256_storeu_si256((__m256i *)words, greater);
+            for (uint64_t word = 0; word < 4; word++) {
+                const uint64_t within = ~words[word] & bitsliced_valid_mask(first + word * 64, number_of_elements);
+                if (within != 0)
+                    return (int64_t)(first + word * 64 + bitsliced_first_bit(within));
+            }
+        }
+        return -1;
+    }
+#else
+    inline int64_t bitsliced_within_dist__extra(const uint8_t* sliced, const uint64_t number_of_elements,
+                                                const uint64_t elem_size, const uint8_t* query,
+                                                const uint64_t max_dist) {
+        return bitsliced_within_dist__classic(sliced, number_of_elements, elem_size, query, max_dist);
+    }
+#endif
+
+
+/*------- Variance ordered layout -------*/
+/* Distances do not depend on the order of bytes inside records, so database and queries can store their
+   bytes in any common order. Threshold kernels stop sooner when bytes likely to differ come first: byte
+   positions are ranked by the expected number of their bits differing between two records, the sum of
+   2 * p * (1 - p) over the bits of the byte, where p is the frequency of the bit in a sample of records. */
+
+/**
+ * Stores to `permutation` byte positions of a record, most discriminative first, ties by position.
+ * At most `sample_size` records, evenly spaced over `array`, are measured.
+ */
+inline void variance_permutation_bytes(const uint8_t* array, const uint64_t number_of_elements,
+                                       const uint64_t elem_size, const uint64_t sample_size,
+                                       uint64_t* permutation) {
+    std::vector<uint64_t> ones(elem_size * 8, 0);
+    const uint64_t step = sample_size > 0 && number_of_elements > sample_size ? number_of_elements / sample_size : 1;
+    uint64_t sampled = 0;
+    for (uint64_t r = 0; r < number_of_elements && sampled < sample_size; r += step, sampled++) {
+        const uint8_t* record = array + r * elem_size;
+        for (uint64_t byte = 0; byte < elem_size; byte++)
+            for (uint64_t bit = 0; bit < 8; bit++)
+                ones[byte * 8 + bit] += (record[byte] >> bit) & 1;
+    }
+    // ones * (sampled - ones) is 2 * p * (1 - p) scaled by sampled^2 / 2
+    std::vector<uint64_t> score(elem_size, 0);
+    for (uint64_t byte = 0; byte < elem_size; byte++) {
+        for (uint64_t bit = 0; bit < 8; bit++)
+            score[byte] += ones[byte * 8 + bit] * (sampled - ones[byte * 8 + bit]);
+        permutation[byte] = byte;
+    }
+    std::stable_sort(permutation, permutation + elem_size,
+                     [&score](const uint64_t x, const uint64_t y) { return score[x] > score[y]; });
+}
+
+/**
+ * Returns true if `permutation` holds every byte position of a record of `elem_size` bytes once.
+ */
+inline bool is_byte_permutation(const uint64_t* permutation, const uint64_t elem_size) {
+    std::vector<bool> seen(elem_size, false);
+    for (uint64_t byte = 0; byte < elem_size; byte++) {
+        if (permutation[byte] >= elem_size || seen[permutation[byte]])
+            return false;
+        seen[permutation[byte]] = true;
+    }
+    return true;
+}
+
+/**
+ * Byte `k` of every output record is byte `permutation[k]` of the input record.
+ */
+inline void permute_bytes_array(const uint8_t* array, const uint64_t number_of_elements,
+                                const uint64_t elem_size, const uint64_t* permutation, uint8_t* out) {
+    for (uint64_t r = 0; r < number_of_elements; r++, array += elem_size, out += elem_size)
+        for (uint64_t byte = 0; byte < elem_size; byte++)
+            out[byte] = array[permutation[byte]];
+}
+
+
+/*------- Scans over packed arrays -------*/
+typedef uint64_t (*hamming_distance_bytes_fn)(const uint8_t*, const uint8_t*, const uint64_t, const int64_t);
+
+/* Scans read every record once: records `SCAN_PREFETCH_DISTANCE` bytes ahead are requested without
+   polluting caches, which also covers the page boundaries where hardware prefetchers stop. */
+inline constexpr int SCAN_PREFETCH_DISTANCE = 1024;
+inline constexpr int SCAN_LINE_SIZE = 64;
+
+inline void scan_prefetch_line(const uint8_t* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch((const void*)address, 0, 0);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch((const char*)address, _MM_HINT_NTA);
+#else
+    (void)address;
+#endif
+}
+
+/**
+ * Prefetches the line `SCAN_PREFETCH_DISTANCE` bytes ahead of `position` when the scan crosses into it, so
+ * records shorter than a line request each line once. `next` is the end of the last requested line,
+ * start it at the first record.
+ */
+inline void scan_prefetch(const uint8_t* position, const uint8_t** next) {
+    const uint8_t* ahead = position + SCAN_PREFETCH_DISTANCE;
+    if (ahead >= *next) {
+        scan_prefetch_line(ahead);
+        *next = (const uint8_t*)(((uintptr_t)ahead | (SCAN_LINE_SIZE - 1)) + 1);
+    }
+}
+
+/**
+ * Returns index of the first record of `array` within `max_dist` of `query` or -1.
+ *
+ * @param distance  dispatched bytes kernel
+ * @param array     packed records
+ * @param number_of_elements number of records in `array`
+ * @param query     record to compare with
+ * @param elem_size size of one record in bytes
+ * @param max_dist  maximum allowable hamming distance
+ */
+inline int64_t find_within_dist_bytes(hamming_distance_bytes_fn distance, const uint8_t* array,
+                                      const uint64_t number_of_elements, const uint8_t* query,
+                                      const uint64_t elem_size, const int64_t max_dist) {
+    const uint8_t* prefetched = array;
+    for (uint64_t i = 0; i < number_of_elements; i++, array += elem_size) {
+        scan_prefetch(array, &prefetched);
+        if (distance(array, query, elem_size, max_dist) == 1)
+            return (int64_t)i;
+    }
+    return -1;
+}
+
+/**
+ * Adds distances from every query to every record of `array` into `histogram`. Records are read once,
+ * each is compared with all queries while it is in cache.
+ *
+ * @param distance  dispatched bytes kernel
+ * @param array     packed records
+ * @param number_of_elements number of records in `array`
+ * @param queries   packed records to compare with
+ * @param number_of_queries number of records in `queries`
+ * @param elem_size size of one record in bytes
+ * @param histogram array of `elem_size * 8 + 1` buckets, bucket `d` counts pairs at distance `d`
+ */
+inline void distance_histogram_bytes(hamming_distance_bytes_fn distance, const uint8_t* array,
+                                     const uint64_t number_of_elements, const uint8_t* queries,
+                                     const uint64_t number_of_queries, const uint64_t elem_size,
+                                     uint64_t* histogram) {
+    const uint8_t* prefetched = array;
+    for (uint64_t i = 0; i < number_of_elements; i++, array += elem_size) {
+        scan_prefetch(array, &prefetched);
+        const uint8_t* query = queries;
+        for (uint64_t q = 0; q < number_of_queries; q++, query += elem_size)
+            histogram[distance(array, query, elem_size, -1)]++;
+    }
+}
+
+/**
+ * Returns number of (record, query) pairs within `max_dist`. Records are read once, each is compared
+ * with all queries while it is in cache.
+ *
+ * @param distance  dispatched bytes kernel
+ * @param array     packed records
+ * @param number_of_elements number of records in `array`
+ * @param queries   packed records to compare with
+ * @param number_of_queries number of records in `queries`
+ * @param elem_size size of one record in bytes
+ * @param max_dist  maximum allowable hamming distance
+ * @return          number of pairs with distance <= max_dist
+ */
+inline uint64_t count_within_dist_bytes(hamming_distance_bytes_fn distance, const uint8_t* array,
+                                        const uint64_t number_of_elements, const uint8_t* queries,
+                                        const uint64_t number_of_queries, const uint64_t elem_size,
+                                        const int64_t max_dist) {
+    uint64_t count = 0;
+    const uint8_t* prefetched = array;
+    for (uint64_t i = 0; i < number_of_elements; i++, array += elem_size) {
+        scan_prefetch(array, &prefetched);
+        const uint8_t* query = queries;
+        for (uint64_t q = 0; q < number_of_queries; q++, query += elem_size)
+            count += distance(array, query, elem_size, max_dist);
+    }
+    return count;
+}
+
+/*------- Fixed width records -------*/
+/* Records of 8, 16, 24 or 32 bytes are compared word by word with a fully unrolled loop, without
+   the length checks and tail handling of the general kernels. Same contract as hamming_distance_bytes. */
+
+inline constexpr int FIXED_WIDTH_MAX_WORDS = 4;
+
+template <uint64_t (*popcnt64)(uint64_t), int words>
+inline uint64_t hamming_distance_words(const uint8_t* a, const uint8_t* b, const uint64_t /* length */,
+                                       const int64_t max_dist) {
+    uint64_t difference = 0;
+    for (int i = 0; i < words; i++)
+        difference += popcnt64(*(uint64_t*)(a + 8 * i) ^ *(uint64_t*)(b + 8 * i));
+    if (max_dist < 0)
+        return difference;
+    return difference <= (uint64_t)max_dist;
+}
+
+/* find_within_dist_words, find_within_dist_words__avx2, find_within_dist_words__avx512:
+   Same result as `find_within_dist_bytes` for records of 8 or 16 bytes (`words` 1 or 2), max_dist >= 0.
+   The SIMD kernels XOR several records at once with the broadcast query, popcount every 64-bit
+   lane (for 16 bytes records the two lanes are added) and compare all lanes with `max_dist` at once,
+   so a single mask test covers two registers of records. */
+typedef int64_t (*find_within_dist_fn)(const uint8_t*, const uint64_t, const uint8_t*, const int64_t);
+
+inline constexpr int BATCH_MAX_WORDS = 2;
+
+template <uint64_t (*popcnt64)(uint64_t), int words>
+inline int64_t find_within_dist_words(const uint8_t* array, const uint64_t number_of_elements,
+                                      const uint8_t* query, const int64_t max_dist) {
+    const uint8_t* prefetched = array;
+    for (uint64_t i = 0; i < number_of_elements; i++, array += 8 * words) {
+        scan_prefetch(array, &prefetched);
+        if (hamming_distance_words<popcnt64, words>(array, query, 8 * words, max_dist) == 1)
+            return (int64_t)i;
+    }
+    return -1;
+}
+
+#if defined(HEXHAMMING_X64_EXTRA)
+    template <int words>
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline int64_t find_within_dist_words__avx2(const uint8_t* array, const uint64_t number_of_elements,
+                                                const uint8_t* query, const int64_t max_dist) {
+        const uint64_t step = 8 / words;                        // records in two registers
+        const __m256i broadcast = words == 1 ? _mm256_set1_epi64x(*(const int64_t*)query)
+                                             : _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)query));
+        const __m256i limit = _mm256_set1_epi64x(max_dist);
+        uint64_t i = 0;
+        for (; i + step <= number_of_elements; i += step) {
+            const uint8_t* records = array + i * 8 * words;
+            scan_prefetch_line(records + SCAN_PREFETCH_DISTANCE);
+            __m256i low = popcnt256_lanes__avx2(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)records),
+                                                                 broadcast));
+            __m256i high = popcnt256_lanes__avx2(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(records + 32)),
+                                                                  broadcast));
+            if (words == 2) {
+                low = _mm256_add_epi64(low, _mm256_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+                high = _mm256_add_epi64(high, _mm256_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+            }
+            const int over = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(low, limit))) |
+                             _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(high, limit))) << 4;
+            if (over != 0xFF)
+                return (int64_t)(i + bitsliced_first_bit(~over & 0xFF) / words);
+        }
+        const int64_t position = find_within_dist_words<popcnt64__native, words>(
+            array + i * 8 * words, number_of_elements - i, query, max_dist);
+        return position < 0 ? -1 : (int64_t)i + position;
+    }
+#else
+    template <int words>
+    inline int64_t find_within_dist_words__avx2(const uint8_t* array, const uint64_t number_of_elements,
+                                                const uint8_t* query, const int64_t max_dist) {
+        return find_within_dist_words<popcnt64__classic, words>(array, number_of_elements, query, max_dist);
+    }
+#endif
+
+#if defined(HEXHAMMING_HAVE_AVX512)
+    template <int words>
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx512bw")))
+    #endif
+    inline int64_t find_within_dist_words__avx512(const uint8_t* array, const uint64_t number_of_elements,
+                                                  const uint8_t* query, const int64_t max_dist) {
+        const uint64_t step = 8 / words;                        // records in one register
+        const int64_t first = *(const int64_t*)query;
+        const int64_t second = *(const int64_t*)(query + 8 * (words - 1));
+        const __m512i broadcast = _mm512_set_epi64(second, first, second, first, second, first, second, first);
+        const __m512i limit = _mm512_set1_epi64(max_dist);
+        uint64_t i = 0;
+        for (; i + 2 * step <= number_of_elements; i += 2 * step) {
+            const uint8_t* records = array + i * 8 * words;
+            scan_prefetch_line(records + SCAN_PREFETCH_DISTANCE);
+            __m512i low = popcnt512_lanes__avx512(_mm512_xor_si512(_mm512_loadu_si512((const void*)records),
+                                                                   broadcast));
+            __m512i high = popcnt512_lanes__avx512(_mm512_xor_si512(_mm512_loadu_si512((const void*)(records + 64)),
+                                                                    broadcast));
+            // zero-masked shuffles, the plain one starts from an undefined register GCC warns about
+            if (words == 2) {
+                low = _mm512_add_epi64(low, _mm512_maskz_shuffle_epi32(0xFFFF, low, _MM_PERM_BADC));
+                high = _mm512_add_epi64(high, _mm512_maskz_shuffle_epi32(0xFFFF, high, _MM_PERM_BADC));
+            }
+            const uint32_t within = _mm512_cmple_epi64_mask(low, limit) |
+                                    (uint32_t)_mm512_cmple_epi64_mask(high, limit) << 8;
+            if (within != 0)
+                return (int64_t)(i + bitsliced_first_bit(within) / words);
+        }
+        for (; i < number_of_elements; i += step) {
+            const uint64_t remaining = number_of_elements - i < step ? number_of_elements - i : step;
+            const __m512i data = _mm512_maskz_loadu_epi8(tail_mask__avx512(remaining * 8 * words),
+                                                         array + i * 8 * words);
+            __m512i distances = popcnt512_lanes__avx512(_mm512_xor_si512(data, broadcast));
+            if (words == 2)
+                distances = _mm512_add_epi64(distances, _mm512_maskz_shuffle_epi32(0xFFFF, distances, _MM_PERM_BADC));
+            const __mmask8 valid = (__mmask8)((1u << (remaining * words)) - 1);
+            const __mmask8 within = _mm512_mask_cmple_epi64_mask(valid, distances, limit);
+            if (within != 0)
+                return (int64_t)(i + bitsliced_first_bit(within) / words);
+        }
+        return -1;
+    }
+#endif
+
+/*------- Sliding window search -------*/
+/* Hamming distance of a pattern at every byte or bit offset of a stream. Bits are numbered from the
+   most significant bit of the first byte. For bit offsets, eight copies of the pattern shifted by
+   0..7 bits are prepared once, each with a mask of its valid bits, so every offset is a masked
+   comparison of whole bytes with one of the copies and nothing is shifted in the loop.
+
+   sliding_hamming__classic/native:
+   Patterns up to 7 bytes fit, with every shift, into one 64-bit word: the stream is loaded once per
+   byte offset and compared with all copies kept in registers. Longer patterns are compared word by word.
+   sliding_hamming__avx2:
+   32 consecutive offsets at once: byte `j` of the pattern is broadcast and compared with 32 stream bytes
+   starting at `offset + j`, per-offset distances are summed in saturating byte lanes. */
+
+inline constexpr int SLIDING_MAX_SHIFTS = 8;
+
+// Called for every offset with distance <= max_dist, in increasing offset order.
+typedef void (*sliding_match_fn)(void* context, const uint64_t offset, const uint64_t distance);
+
+/**
+ * Writes `pattern` shifted right by `shift` bits into `size + 1` bytes of `shifted`
+ * and the mask of its bits into `size + 1` bytes of `mask`.
+ */
+inline void sliding_shift_pattern(const uint8_t* pattern, const uint64_t size, const int shift,
+                                  uint8_t* shifted, uint8_t* mask) {
+    uint8_t carry = 0, mask_carry = 0;
+    for (uint64_t i = 0; i < size; i++) {
+        shifted[i] = (uint8_t)(carry | (pattern[i] >> shift));
+        mask[i] = (uint8_t)(mask_carry | (0xFF >> shift));
+        carry = shift ? (uint8_t)(pattern[i] << (8 - shift)) : 0;
+        mask_carry = shift ? (uint8_t)(0xFF << (8 - shift)) : 0;
+    }
+    shifted[size] = carry;
+    mask[size] = mask_carry;
+}
+
+// Distance of masked bytes, stops counting as soon as it exceeds `max_dist`.
+template <uint64_t (*popcnt64)(uint64_t)>
+inline uint64_t masked_distance(const uint8_t* a, const uint8_t* pattern, const uint8_t* mask,
+                                const uint64_t length, const uint64_t max_dist) {
+    uint64_t difference = 0;
+    uint64_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        difference += popcnt64((*(uint64_t*)(a + i) ^ *(uint64_t*)(pattern + i)) & *(uint64_t*)(mask + i));
+        if (difference > max_dist)
+            return difference;
+    }
+    for (; i < length; i++)
+        difference += popcnt64((uint64_t)((a[i] ^ pattern[i]) & mask[i]));
+    return difference;
+}
+
+/**
+ * Reports every offset of `stream`, starting at byte `offset`, where `pattern` is within `max_dist`.
+ *
+ * @param stream        bytes to search in
+ * @param stream_size   size of `stream` in bytes
+ * @param patterns      `shifts` copies of the pattern from `sliding_shift_pattern`, `pattern_size + 1` bytes each
+ * @param masks         masks of the copies, same layout
+ * @param pattern_size  size of the pattern in bytes
+ * @param max_dist      maximum allowable hamming distance
+ * @param match         receives offset (`byte_offset * shifts + shift`) and distance of every match
+ * @param offset        first byte offset to check
+ */
+template <uint64_t (*popcnt64)(uint64_t), int shifts>
+inline void sliding_hamming_scan(const uint8_t* stream, const uint64_t stream_size, const uint8_t* patterns,
+                                 const uint8_t* masks, const uint64_t pattern_size, const uint64_t max_dist,
+                                 sliding_match_fn match, void* context, uint64_t offset) {
+    const uint64_t stride = pattern_size + 1;
+    if (pattern_size + 1 <= 8) {
+        uint64_t pattern_words[shifts], mask_words[shifts];
+        for (int shift = 0; shift < shifts; shift++) {
+            uint8_t pattern_bytes[8] = {0}, mask_bytes[8] = {0};
+            memcpy(pattern_bytes, patterns + shift * stride, stride);
+            memcpy(mask_bytes, masks + shift * stride, stride);
+            pattern_words[shift] = *(uint64_t*)pattern_bytes;
+            mask_words[shift] = *(uint64_t*)mask_bytes;
+        }
+        for (; offset + 8 <= stream_size; offset++) {
+            if (offset % 64 == 0)
+                scan_prefetch_line(stream + offset + SCAN_PREFETCH_DISTANCE);
+            const uint64_t window = *(uint64_t*)(stream + offset);
+            for (int shift = 0; shift < shifts; shift++) {
+                const uint64_t difference = popcnt64((window ^ pattern_words[shift]) & mask_words[shift]);
+                if (difference <= max_dist)
+                    match(context, offset * shifts + shift, difference);
+            }
+        }
+    }
+    // unshifted pattern covers `pattern_size` bytes, shifted copies spill into one more byte
+    for (; offset + pattern_size <= stream_size; offset++) {
+        for (int shift = 0; shift < shifts; shift++) {
+            const uint64_t length = shift ? pattern_size + 1 : pattern_size;
+            if (offset + length > stream_size)
+                break;
+            const uint64_t difference = masked_distance<popcnt64>(stream + offset, patterns + shift * stride,
+                                                                  masks + shift * stride, length, max_dist);
+            if (difference <= max_dist)
+                match(context, offset * shifts + shift, difference);
+        }
+    }
+}
+
+inline void sliding_hamming__classic(const uint8_t* stream, const uint64_t stream_size, const uint8_t* patterns,
+                                     const uint8_t* masks, const uint64_t pattern_size, const int shifts,
+                                     const uint64_t max_dist, sliding_match_fn match, void* context) {
+    if (shifts == 1)
+        sliding_hamming_scan<popcnt64__classic, 1>(stream, stream_size, patterns, masks, pattern_size,
+                                                   max_dist, match, context, 0);
+    else
+        sliding_hamming_scan<popcnt64__classic, SLIDING_MAX_SHIFTS>(stream, stream_size, patterns, masks,
+                                                                    pattern_size, max_dist, match, context, 0);
+}
+
+#ifdef HEXHAMMING_HAVE_NATIVE_POPCNT
+    inline void sliding_hamming_from__native(const uint8_t* stream, const uint64_t stream_size,
+                                             const uint8_t* patterns, const uint8_t* masks,
+                                             const uint64_t pattern_size, const int shifts, const uint64_t max_dist,
+                                             sliding_match_fn match, void* context, const uint64_t offset) {
+        if (shifts == 1)
+            sliding_hamming_scan<popcnt64__native, 1>(stream, stream_size, patterns, masks, pattern_size,
+                                                      max_dist, match, context, offset);
+        else
+            sliding_hamming_scan<popcnt64__native, SLIDING_MAX_SHIFTS>(stream, stream_size, patterns, masks,
+                                                                       pattern_size, max_dist, match, context,
+                                                                       offset);
+    }
+
+    inline void sliding_hamming__native(const uint8_t* stream, const uint64_t stream_size, const uint8_t* patterns,
+                                        const uint8_t* masks, const uint64_t pattern_size, const int shifts,
+                                        const uint64_t max_dist, sliding_match_fn match, void* context) {
+        sliding_hamming_from__native(stream, stream_size, patterns, masks, pattern_size, shifts, max_dist,
+                                     match, context, 0);
+    }
+#endif
+
+#if defined(HEXHAMMING_X64_EXTRA)
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline __m256i popcnt8_lanes__avx2(__m256i v) {
+        const __m256i lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    }
+
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline void sliding_hamming__avx2(const uint8_t* stream, const uint64_t stream_size, const uint8_t* patterns,
+                                      const uint8_t* masks, const uint64_t pattern_size, const int shifts,
+                                      const uint64_t max_dist, sliding_match_fn match, void* context) {
+        const uint64_t stride = pattern_size + 1;
+        uint64_t offset = 0;
+        // byte lanes saturate at 255, larger limits are left to the scalar loop
+        if (max_dist < 255) {
+            const __m256i limit = _mm256_set1_epi8((char)max_dist);
+            uint8_t distances[SLIDING_MAX_SHIFTS][32];
+            uint32_t matched[SLIDING_MAX_SHIFTS];
+            for (; offset + 32 + stride <= stream_size; offset += 32) {
+                scan_prefetch_line(stream + offset + SCAN_PREFETCH_DISTANCE);
+                uint32_t any_matched = 0;
+                for (int shift = 0; shift < shifts; shift++) {
+                    const uint8_t* pattern = patterns + shift * stride;
+                    const uint8_t* mask = masks + shift * stride;
+                    const uint64_t length = shift ? stride : pattern_size;
+                    __m256i distance = _mm256_setzero_si256();
+                    uint32_t within = 1;
+                    for (uint64_t j = 0; j < length; j++) {
+                        __m256i window = _mm256_loadu_si256((const __m256i*)(stream + offset + j));
+                        __m256i difference = _mm256_and_si256(_mm256_xor_si256(window, _mm256_set1_epi8((char)pattern[j])),
+                                                              _mm256_set1_epi8((char)mask[j]));
+                        distance = _mm256_adds_epu8(distance, popcnt8_lanes__avx2(difference));
+                        // long patterns: stop once every offset is out of reach
+                        if (j % 8 == 7) {
+                            within = (uint32_t)_mm256_movemask_epi8(
+                                _mm256_cmpeq_epi8(_mm256_min_epu8(distance, limit), distance));
+                            if (within == 0)
+                                break;
+                        }
+                    }
+                    if (within != 0)
+                        within = (uint32_t)_mm256_movemask_epi8(
+                            _mm256_cmpeq_epi8(_mm256_min_epu8(distance, limit), distance));
+                    matched[shift] = within;
+                    any_matched |= within;
+                    if (within != 0)
+                        _mm256_storeu_si256((__m256i*)distances[shift], distance);
+                }
+                for (; any_matched != 0; any_matched &= any_matched - 1) {
+                    const uint64_t lane = popcnt64__native((any_matched & (0u - any_matched)) - 1);
+                    for (int shift = 0; shift < shifts; shift++)
+                        if ((matched[shift] >> lane) & 1)
+                            match(context, (offset + lane) * shifts + shift, distances[shift][lane]);
+                }
+            }
+        }
+        sliding_hamming_from__native(stream, stream_size, patterns, masks, pattern_size, shifts, max_dist,
+                                     match, context, offset);
+    }
+#endif
+
+inline void sliding_hamming__extra(const uint8_t* stream, const uint64_t stream_size, const uint8_t* patterns,
+                                   const uint8_t* masks, const uint64_t pattern_size, const int shifts,
+                                   const uint64_t max_dist, sliding_match_fn match, void* context) {
+#if defined(HEXHAMMING_X64_EXTRA)
+    sliding_hamming__avx2(stream, stream_size, patterns, masks, pattern_size, shifts, max_dist, match, context);
+#elif defined(HEXHAMMING_HAVE_NATIVE_POPCNT)
+    sliding_hamming__native(stream, stream_size, patterns, masks, pattern_size, shifts, max_dist, match, context);
+#else
+    sliding_hamming__classic(stream, stream_size, patterns, masks, pattern_size, shifts, max_dist, match, context);
+#endif
+}
+
+
+
+/*------- Float32 vectors (re-ranking) -------*/
+/* vector_score__classic, vector_score__sse, vector_score__avx2, vector_score__neon, vector_score__avx512:
+   Dot product (VECTOR_DOT) or squared L2 distance (VECTOR_L2) of two float32 vectors of `dimensions` items.
+   Vector kernels keep several partial sums, so results may differ from the classic loop in the last bits. */
+enum vector_metric { VECTOR_DOT = 0, VECTOR_L2 = 1 };
+typedef float (*vector_score_fn)(const float*, const float*, const uint64_t);
+
+template <int metric>
+inline float vector_score__classic(const float* a, const float* b, const uint64_t dimensions) {
+    float sum = 0;
+    for (uint64_t i = 0; i < dimensions; i++)
+        sum += metric == VECTOR_L2 ? (a[i] - b[i]) * (a[i] - b[i]) : a[i] * b[i];
+    return sum;
+}
+
+#ifdef HEXHAMMING_X86_64
+    template <int metric>
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline __m128 vector_term__sse(const float* a, const float* b) {
+        const __m128 a4 = _mm_loadu_ps(a);
+        const __m128 b4 = _mm_loadu_ps(b);
+        if (metric == VECTOR_L2) {
+            const __m128 difference = _mm_sub_ps(a4, b4);
+            return _mm_mul_ps(difference, difference);
+        }
+        return _mm_mul_ps(a4, b4);
+    }
+    template <int metric>
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("sse4.1")))
+    #endif
+    inline float vector_score__sse(const float* a, const float* b, const uint64_t dimensions) {
+        __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+        uint64_t i = 0;
+        for (; i + 8 <= dimensions; i += 8) {
+            sum0 = _mm_add_ps(sum0, vector_term__sse<metric>(a + i, b + i));
+            sum1 = _mm_add_ps(sum1, vector_term__sse<metric>(a + i + 4, b + i + 4));
+        }
+        if (i + 4 <= dimensions) {
+            sum0 = _mm_add_ps(sum0, vector_term__sse<metric>(a + i, b + i));
+            i += 4;
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + vector_score__classic<metric>(a + i, b + i, dimensions - i);
+    }
+#endif
+
+#if defined(HEXHAMMING_X64_EXTRA)
+    template <int metric>
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline __m256 vector_term__avx2(const float* a, const float* b) {
+        const __m256 a8 = _mm256_loadu_ps(a);
+        const __m256 b8 = _mm256_loadu_ps(b);
+        if (metric == VECTOR_L2) {
+            const __m256 difference = _mm256_sub_ps(a8, b8);
+            return _mm256_mul_ps(difference, difference);
+        }
+        return _mm256_mul_ps(a8, b8);
+    }
+    // multiply and add separately: FMA is not part of the AVX2 feature bit
+    template <int metric>
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx2")))
+    #endif
+    inline float vector_score__avx2(const float* a, const float* b, const uint64_t dimensions) {
+        __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+        uint64_t i = 0;
+        for (; i + 16 <= dimensions; i += 16) {
+            sum0 = _mm256_add_ps(sum0, vector_term__avx2<metric>(a + i, b + i));
+            sum1 = _mm256_add_ps(sum1, vector_term__avx2<metric>(a + i + 8, b + i + 8));
+        }
+        if (i + 8 <= dimensions) {
+            sum0 = _mm256_add_ps(sum0, vector_term__avx2<metric>(a + i, b + i));
+            i += 8;
+        }
+        float lanes[8];
+        _mm256_storeu_ps(lanes, _mm256_add_ps(sum0, sum1));
+        return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7])) +
+               vector_score__classic<metric>(a + i, b + i, dimensions - i);
+    }
+#elif defined(HEXHAMMING_ARM_EXTRA)
+    template <int metric>
+    inline float vector_score__neon(const float* a, const float* b, const uint64_t dimensions) {
+        float32x4_t sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0);
+        uint64_t i = 0;
+        for (; i + 8 <= dimensions; i += 8) {
+            const float32x4_t a0 = vld1q_f32(a + i), b0 = vld1q_f32(b + i);
+            const float32x4_t a1 = vld1q_f32(a + i + 4), b1 = vld1q_f32(b + i + 4);
+            if (metric == VECTOR_L2) {
+                const float32x4_t d0 = vsubq_f32(a0, b0), d1 = vsubq_f32(a1, b1);
+                sum0 = vfmaq_f32(sum0, d0, d0);
+                sum1 = vfmaq_f32(sum1, d1, d1);
+            }
+            else {
+                sum0 = vfmaq_f32(sum0, a0, b0);
+                sum1 = vfmaq_f32(sum1, a1, b1);
+            }
+        }
+        return vaddvq_f32(vaddq_f32(sum0, sum1)) + vector_score__classic<metric>(a + i, b + i, dimensions - i);
+    }
+#endif
+
+template <int metric>
+inline float vector_score__extra(const float* a, const float* b, const uint64_t dimensions) {
+#if defined(HEXHAMMING_X64_EXTRA)
+    return vector_score__avx2<metric>(a, b, dimensions);
+#elif defined(HEXHAMMING_ARM_EXTRA)
+    return vector_score__neon<metric>(a, b, dimensions);
+#else
+    return vector_score__classic<metric>(a, b, dimensions);
+#endif
+}
+
+#if defined(HEXHAMMING_HAVE_AVX512)
+    template <int metric>
+    #if !defined(_MSC_VER)
+        __attribute__ ((target ("avx512f")))
+    #endif
+    inline float vector_score__avx512(const float* a, const float* b, const uint64_t dimensions) {
+        __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+        uint64_t i = 0;
+        for (; i + 32 <= dimensions; i += 32) {
+            const __m512 a0 = _mm512_loadu_ps(a + i), b0 = _mm512_loadu_ps(b + i);
+            const __m512 a1 = _mm512_loadu_ps(a + i + 16), b1 = _mm512_loadu_ps(b + i + 16);
+            if (metric == VECTOR_L2) {
+                const __m512 d0 = _mm512_sub_ps(a0, b0), d1 = _mm512_sub_ps(a1, b1);
+                sum0 = _mm512_fmadd_ps(d0, d0, sum0);
+                sum1 = _mm512_fmadd_ps(d1, d1, sum1);
+            }
+            else {
+                sum0 = _mm512_fmadd_ps(a0, b0, sum0);
+                sum1 = _mm512_fmadd_ps(a1, b1, sum1);
+            }
+        }
+        for (; i < dimensions; i += 16) {
+            const __mmask16 tail = dimensions - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (dimensions - i)) - 1);
+            const __m512 a0 = _mm512_maskz_loadu_ps(tail, a + i), b0 = _mm512_maskz_loadu_ps(tail, b + i);
+            if (metric == VECTOR_L2) {
+                const __m512 d0 = _mm512_sub_ps(a0, b0);
+                sum0 = _mm512_fmadd_ps(d0, d0, sum0);
+            }
+            else {
+                sum0 = _mm512_fmadd_ps(a0, b0, sum0);
+            }
+        }
+        float lanes[16];
+        _mm512_storeu_ps(lanes, _mm512_add_ps(sum0, sum1));
+        float sum = 0;
+        for (int lane = 0; lane < 16; lane++)
+            sum += lanes[lane];
+        return sum;
+    }
+#endif
+
+#define VECTOR_KERNELS(vector_score) { \
+    &vector_score<VECTOR_DOT>, \
+    &vector_score<VECTOR_L2>, \
+}
+
+// Identifies kernel tables in traces, same order as hexhamming::algorithm.
+enum kernels_id { KERNELS_ID_AVX512, KERNELS_ID_EXTRA, KERNELS_ID_NATIVE, KERNELS_ID_SSE41, KERNELS_ID_CLASSIC };
+
+//  Kernel tables, one for each algorithm. Selected algorithm is swapped as a single pointer.
+struct hexhamming_kernels {
+    uint64_t (*hamming_distance_bytes)(const uint8_t*, const uint8_t*, const uint64_t, const int64_t);
+    uint64_t (*hamming_distance_string)(const char*, const char*, const uint64_t);
+    void (*and_or_popcount_bytes)(const uint8_t*, const uint8_t*, const uint64_t, uint64_t*, uint64_t*);
+    int64_t (*bitsliced_within_dist)(const uint8_t*, const uint64_t, const uint64_t, const uint8_t*, const uint64_t);
+    void (*sliding_hamming)(const uint8_t*, const uint64_t, const uint8_t*, const uint8_t*, const uint64_t, const int,
+                            const uint64_t, sliding_match_fn, void*);
+    hamming_distance_bytes_fn hamming_distance_words[FIXED_WIDTH_MAX_WORDS];    // 1 to 4 words
+    find_within_dist_fn find_within_dist_words[BATCH_MAX_WORDS];              // 1 or 2 words
+    vector_score_fn vector_score[2];                                           // VECTOR_DOT, VECTOR_L2
+    int id;                                                                    // kernels_id
+};
+
+#define WORDS_KERNELS(popcnt64) { \
+    &hamming_distance_words<popcnt64, 1>, \
+    &hamming_distance_words<popcnt64, 2>, \
+    &hamming_distance_words<popcnt64, 3>, \
+    &hamming_distance_words<popcnt64, 4>, \
+}
+
+#define BATCH_KERNELS(popcnt64) { \
+    &find_within_dist_words<popcnt64, 1>, \
+    &find_within_dist_words<popcnt64, 2>, \
+}
+
+#if defined(HEXHAMMING_HAVE_AVX512)
+inline constexpr hexhamming_kernels KERNELS__AVX512 = {
+    &hamming_distance_bytes__avx512,
+    &hamming_distance_string__sse,
+    &and_or_popcount_bytes__avx512,
+    &bitsliced_within_dist__extra,
+    &sliding_hamming__extra,
+    WORDS_KERNELS(popcnt64__native),
+    { &find_within_dist_words__avx512<1>, &find_within_dist_words__avx512<2> },
+    VECTOR_KERNELS(vector_score__avx512),
+    KERNELS_ID_AVX512,
+};
+#endif
+
+#if defined(HEXHAMMING_X86_64)
+inline constexpr hexhamming_kernels KERNELS__EXTRA = {
+    &hamming_distance_bytes__extra,
+    &hamming_distance_string__sse,
+    &and_or_popcount_bytes__extra,
+    &bitsliced_within_dist__extra,
+    &sliding_hamming__extra,
+    WORDS_KERNELS(popcnt64__native),
+    { &find_within_dist_words__avx2<1>, &find_within_dist_words__avx2<2> },
+    VECTOR_KERNELS(vector_score__extra),
+    KERNELS_ID_EXTRA,
+};
+#else
+inline constexpr hexhamming_kernels KERNELS__EXTRA = {
+    &hamming_distance_bytes__extra,
+    &hamming_distance_loop_string,
+    &and_or_popcount_bytes__extra,
+    &bitsliced_within_dist__classic,
+    &sliding_hamming__extra,
+#if defined(HEXHAMMING_HAVE_NATIVE_POPCNT)
+    WORDS_KERNELS(popcnt64__native),
+    BATCH_KERNELS(popcnt64__native),
+#else
+    WORDS_KERNELS(popcnt64__classic),
+    BATCH_KERNELS(popcnt64__classic),
+#endif
+    VECTOR_KERNELS(vector_score__extra),
+    KERNELS_ID_EXTRA,
+};
+#endif
+
+#if defined(HEXHAMMING_HAVE_NATIVE_POPCNT)
+#if defined(HEXHAMMING_X86_64)
+inline constexpr hexhamming_kernels KERNELS__NATIVE = {
+    &hamming_distance_bytes__native,
+    &hamming_distance_string__sse,
+    &and_or_popcount_bytes__native,
+    &bitsliced_within_dist__classic,
+    &sliding_hamming__native,
+    WORDS_KERNELS(popcnt64__native),
+    BATCH_KERNELS(popcnt64__native),
+    VECTOR_KERNELS(vector_score__sse),
+    KERNELS_ID_NATIVE,
+};
+#else
+inline constexpr hexhamming_kernels KERNELS__NATIVE = {
+    &hamming_distance_bytes__native,
+    &hamming_distance_loop_string,
+    &and_or_popcount_bytes__native,
+    &bitsliced_within_dist__classic,
+    &sliding_hamming__native,
+    WORDS_KERNELS(popcnt64__native),
+    BATCH_KERNELS(popcnt64__native),
+    VECTOR_KERNELS(vector_score__extra),
+    KERNELS_ID_NATIVE,
+};
+#endif
+#endif
+
+#if defined(HEXHAMMING_X86_64)
+inline constexpr hexhamming_kernels KERNELS__SSE41 = {
+    &hamming_distance_bytes__sse,
+    &hamming_distance_string__sse,
+    &and_or_popcount_bytes__sse,
+    &bitsliced_within_dist__classic,
+    &sliding_hamming__classic,
+    WORDS_KERNELS(popcnt64__classic),
+    BATCH_KERNELS(popcnt64__classic),
+    VECTOR_KERNELS(vector_score__sse),
+    KERNELS_ID_SSE41,
+};
+#endif
+
+inline constexpr hexhamming_kernels KERNELS__CLASSIC = {
+    &hamming_distance_bytes__classic,
+    &hamming_distance_loop_string,
+    &and_or_popcount_bytes__classic,
+    &bitsliced_within_dist__classic,
+    &sliding_hamming__classic,
+    WORDS_KERNELS(popcnt64__classic),
+    BATCH_KERNELS(popcnt64__classic),
+    VECTOR_KERNELS(vector_score__classic),
+    KERNELS_ID_CLASSIC,
+};
+
+/**
+ * Returns bytes kernel for records of `length` bytes from `kernels`.
+ */
+inline hamming_distance_bytes_fn bytes_kernel_for_length(const hexhamming_kernels* kernels,
+                                                         const uint64_t length) {
+    if (length % 8 == 0 && length > 0 && length <= 8 * FIXED_WIDTH_MAX_WORDS)
+        return kernels->hamming_distance_words[length / 8 - 1];
+    return kernels->hamming_distance_bytes;
+}
+
+/**
+ * Returns index of the first record of `array` within `max_dist` of `query` or -1, with the batch
+ * kernels of `kernels` for 8 and 16 bytes records and the fixed width ones for other word multiples.
+ */
+inline int64_t find_within_dist(const hexhamming_kernels* kernels, const uint8_t* array,
+                                const uint64_t number_of_elements, const uint8_t* query,
+                                const uint64_t elem_size, const int64_t max_dist) {
+    if (elem_size % 8 == 0 && elem_size > 0 && elem_size <= 8 * BATCH_MAX_WORDS)
+        return kernels->find_within_dist_words[elem_size / 8 - 1](array, number_of_elements, query, max_dist);
+    return find_within_dist_bytes(bytes_kernel_for_length(kernels, elem_size), array, number_of_elements, query,
+                                  elem_size, max_dist);
+}
+
+/**
+ * Returns fastest kernels supported by CPU.
+ *
+ * @param cpu_capabilities bit mask returned by `get_cpuid`
+ */
+inline const hexhamming_kernels* best_kernels(const int cpu_capabilities) {
+#if defined(HEXHAMMING_X86_64)
+#if defined(HEXHAMMING_HAVE_AVX512)
+    if ((cpu_capabilities & (CPU_AVX2 | CPU_AVX512)) == (CPU_AVX2 | CPU_AVX512))
+        return &KERNELS__AVX512;
+#endif
+    if ((cpu_capabilities & CPU_AVX2) == CPU_AVX2)
+        return &KERNELS__EXTRA;
+#if defined(HEXHAMMING_HAVE_NATIVE_POPCNT)
+    if ((cpu_capabilities & (CPU_POPCNT | CPU_SSE41)) == (CPU_POPCNT | CPU_SSE41))
+        return &KERNELS__NATIVE;
+#endif
+    if ((cpu_capabilities & CPU_SSE41) == CPU_SSE41)
+        return &KERNELS__SSE41;
+    return &KERNELS__CLASSIC;
+#else
+    return &KERNELS__EXTRA;
+#endif
+}
+
+#undef VECTOR_KERNELS
+#undef WORDS_KERNELS
+#undef BATCH_KERNELS
+
+}  // namespace detail
+}  // namespace hexhamming
+
+#undef HEXHAMMING_HAS_BUILTIN
+#undef HEXHAMMING_HAS_ATTRIBUTE
+#undef HEXHAMMING_GNUC_PREREQ
+#undef HEXHAMMING_CLANG_PREREQ
+
+#endif  //HEXHAMMING_KERNELS_H
@@ -0,0 +1,92 @@
+#ifndef HEXHAMMING_NUMA_H
+#define HEXHAMMING_NUMA_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+    #define HAVE_NUMA_TOPOLOGY
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+// CPUs of every NUMA node, node `n` is element `n`.
+typedef std::vector<std::vector<int>> hexhamming_numa_topology;
+
+/**
+ * Parses a kernel list like "0-3,8-11".
+ */
+static std::vector<int> parse_cpu_list(const std::string &list) {
+    std::vector<int> values;
+    size_t position = 0;
+    while (position < list.size()) {
+        int first, last, consumed = 0;
+        if (sscanf(list.c_str() + position, "%d%n", &first, &consumed) != 1)
+            break;
+        position += consumed;
+        last = first;
+        if (position < list.size() && list[position] == '-') {
+            position++;
+            if (sscanf(list.c_str() + position, "%d%n", &last, &consumed) != 1)
+                break;
+            position += consumed;
+        }
+        for (int value = first; value <= last; value++)
+            values.push_back(value);
+        while (position < list.size() && (list[position] == ',' || list[position] == '\n'))
+            position++;
+    }
+    return values;
+}
+
+static std::string read_first_line(const std::string &path) {
+    std::string line;
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == NULL)
+        return line;
+    char buffer[4096];
+    if (fgets(buffer, sizeof(buffer), file) != NULL)
+        line = buffer;
+    fclose(file);
+    return line;
+}
+
+/**
+ * Returns online NUMA nodes with at least one CPU, or an empty topology when it is unknown
+ * (non-Linux systems, no sysfs); callers then treat the machine as a single node.
+ */
+static hexhamming_numa_topology numa_topology() {
+    hexhamming_numa_topology topology;
+#if defined(HAVE_NUMA_TOPOLOGY)
+    const std::string root = "/sys/devices/system/node/";
+    for (int node : parse_cpu_list(read_first_line(root + "online"))) {
+        std::vector<int> cpus = parse_cpu_list(read_first_line(root + "node" + std::to_string(node) + "/cpulist"));
+        if (!cpus.empty())
+            topology.push_back(cpus);
+    }
+#endif
+    return topology;
+}
+
+// Number of NUMA nodes, 1 when the topology is unknown.
+static size_t numa_node_count() {
+    static const size_t count = numa_topology().size();
+    return count > 1 ? count : 1;
+}
+
+/**
+ * Restricts calling thread to `cpus`. Failures are ignored: the thread keeps running unpinned.
+ */
+static void pin_current_thread(const std::vector<int> &cpus) {
+#if defined(HAVE_NUMA_TOPOLOGY)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+#endif  //HEXHAMMING_NUMA_H
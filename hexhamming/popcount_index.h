@@ -0,0 +1,131 @@
+#ifndef HEXHAMMING_POPCOUNT_INDEX_H
+#define HEXHAMMING_POPCOUNT_INDEX_H
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "kernels.h"
+
+using hexhamming::detail::bytes_kernel_for_length;
+using hexhamming::detail::find_within_dist;
+using hexhamming::detail::hamming_distance_bytes_fn;
+using hexhamming::detail::hexhamming_kernels;
+
+/**
+ * Immutable copy of packed records grouped by popcount (norm). |popcount(a) - popcount(b)| is a
+ * lower bound of the Hamming distance of `a` and `b`, so searches skip every bucket whose norm
+ * differs from the norm of the query by more than the distance they look for, without reading
+ * its records. Surviving buckets are scanned with the usual threshold kernels.
+ *
+ * Bucket `n` holds records with popcount `n` in their original order, `positions` maps them back
+ * to indices in the original array.
+ */
+class hexhamming_popcount_index {
+public:
+    hexhamming_popcount_index(const uint8_t *array, const uint64_t number_of_elements, const uint64_t elem_size,
+                              const hexhamming_kernels *kernels)
+        : elem_size(elem_size), zeros(elem_size, 0), records(number_of_elements * elem_size),
+          positions(number_of_elements), bucket_start(elem_size * 8 + 2, 0) {
+        std::vector<uint64_t> norms(number_of_elements);
+        for (uint64_t i = 0; i < number_of_elements; i++) {
+            norms[i] = kernels->hamming_distance_bytes(array + i * elem_size, zeros.data(), elem_size, -1);
+            bucket_start[norms[i] + 1]++;
+        }
+        for (uint64_t norm = 1; norm < bucket_start.size(); norm++)
+            bucket_start[norm] += bucket_start[norm - 1];
+        std::vector<uint64_t> next(bucket_start.begin(), bucket_start.end() - 1);
+        for (uint64_t i = 0; i < number_of_elements; i++) {
+            const uint64_t slot = next[norms[i]]++;
+            memcpy(&records[slot * elem_size], array + i * elem_size, elem_size);
+            positions[slot] = i;
+        }
+    }
+
+    uint64_t get_elem_size() const {
+        return elem_size;
+    }
+
+    uint64_t size() const {
+        return positions.size();
+    }
+
+    /**
+     * Appends to `found` indices of all records within `max_dist` of `query`, in increasing order.
+     */
+    void within(const uint8_t *query, const int64_t max_dist, const hexhamming_kernels *kernels,
+                std::vector<uint64_t> &found) const {
+        const uint64_t norm = query_norm(query, kernels);
+        const uint64_t first = norm > (uint64_t)max_dist ? norm - (uint64_t)max_dist : 0;
+        const uint64_t last = std::min(norm + (uint64_t)max_dist, elem_size * 8);
+        for (uint64_t bucket = first; bucket <= last; bucket++) {
+            uint64_t start = bucket_start[bucket];
+            const uint64_t end = bucket_start[bucket + 1];
+            while (start < end) {
+                const int64_t hit = find_within_dist(kernels, &records[start * elem_size], end - start, query,
+                                                     elem_size, max_dist);
+                if (hit < 0)
+                    break;
+                found.push_back(positions[start + hit]);
+                start += hit + 1;
+            }
+        }
+        std::sort(found.begin(), found.end());
+    }
+
+    /**
+     * Stores to `nearest` up to `k` (distance, index) pairs of records closest to `query`, ordered by
+     * distance, ties by index. Buckets are visited by increasing norm difference and the search stops
+     * once that difference exceeds the distance of the k-th best record found so far.
+     */
+    void nearest(const uint8_t *query, const uint64_t k, const hexhamming_kernels *kernels,
+                 std::vector<std::pair<uint64_t, uint64_t>> &nearest) const {
+        nearest.clear();
+        if (k == 0)
+            return;
+        const hamming_distance_bytes_fn distance = bytes_kernel_for_length(kernels, elem_size);
+        const uint64_t norm = query_norm(query, kernels);
+        const uint64_t max_norm = elem_size * 8;
+        // max heap on (distance, index), its front is the worst of the best `k`
+        for (uint64_t difference = 0; difference <= max_norm; difference++) {
+            if (nearest.size() == k && difference > nearest.front().first)
+                break;
+            for (int side = 0; side < (difference == 0 ? 1 : 2); side++) {
+                if (side == 0 ? difference > norm : norm + difference > max_norm)
+                    continue;
+                const uint64_t bucket = side == 0 ? norm - difference : norm + difference;
+                for (uint64_t slot = bucket_start[bucket]; slot < bucket_start[bucket + 1]; slot++) {
+                    const uint8_t *record = &records[slot * elem_size];
+                    if (nearest.size() == k &&
+                        distance(record, query, elem_size, (int64_t)nearest.front().first) == 0)
+                        continue;
+                    const std::pair<uint64_t, uint64_t> candidate(distance(record, query, elem_size, -1),
+                                                                  positions[slot]);
+                    if (nearest.size() == k) {
+                        if (!(candidate < nearest.front()))
+                            continue;
+                        std::pop_heap(nearest.begin(), nearest.end());
+                        nearest.pop_back();
+                    }
+                    nearest.push_back(candidate);
+                    std::push_heap(nearest.begin(), nearest.end());
+                }
+            }
+        }
+        std::sort_heap(nearest.begin(), nearest.end());
+    }
+
+private:
+    uint64_t query_norm(const uint8_t *query, const hexhamming_kernels *kernels) const {
+        return kernels->hamming_distance_bytes(query, zeros.data(), elem_size, -1);
+    }
+
+    const uint64_t elem_size;
+    const std::vector<uint8_t> zeros;
+    std::vector<uint8_t> records;
+    std::vector<uint64_t> positions;
+    std::vector<uint64_t> bucket_start;     // bucket `n` is [bucket_start[n], bucket_start[n + 1])
+};
+
+#endif  //HEXHAMMING_POPCOUNT_INDEX_H
@@ -1,20 +1,103 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <vector>
 #include <cstring>
 #include <string.h>
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
-#include "python_hexhamming.h"
-#include "_version.h"
+#include "hexhamming.hpp"
+#include "thread_pool.h"
+#include "index.h"
+#include "popcount_index.h"
+#include "rerank.h"
+#include "shared_memory.h"
+#include "trace.h"
+
+using namespace hexhamming::detail;
+
+#if PY_VERSION_HEX < 0x03090000
+    #define PyInterpreterState_Get() (PyThreadState_Get()->interp)
+#endif
 
 
 ///////////////////////////////////////////////////////////////
 // C API
 ///////////////////////////////////////////////////////////////
 
-//Pointers to functions. Will be inited in PyMODINIT_FUNC by USE__* macros(can be found at end of header file).
-static uint64_t (*ptr__hamming_distance_bytes)(const uint8_t*, const uint8_t*, const uint64_t, const int64_t);
-static uint64_t (*ptr__hamming_distance_string)(const char*, const char*, const uint64_t);
-static int cpu_capabilities;            //Bit mask off CPU capabilities.
-char cpu_not_support_msg[64];           //"CPU doesnt support this feature. %X" , cpu_capabilities
+/**
+ * Counter of asynchronous requests not completed yet. Interpreter waits for it to drop to zero
+ * before finalization, so workers never complete a future of a dead interpreter.
+ */
+class hexhamming_pending {
+public:
+    void add() {
+        std::lock_guard<std::mutex> lock(mutex);
+        count++;
+    }
+
+    void done() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--count == 0)
+            all_done.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this] { return count == 0; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable all_done;
+    uint64_t count = 0;
+};
+
+/**
+ * Per-module state. Kernels are selected in module exec slot and may be swapped by `set_algo`
+ * from any thread, so wrappers load the table pointer once per call.
+ */
+typedef struct {
+    std::atomic<const hexhamming_kernels*> kernels;
+    int cpu_capabilities;                   //Bit mask off CPU capabilities.
+    char cpu_not_support_msg[64];           //"CPU doesnt support this feature. %X" , cpu_capabilities
+    hexhamming_pending *pending;            //Asynchronous requests of this module.
+    hexhamming_latency *latency;            //Latency histograms of entry points, see `set_latency_histograms`.
+    PyObject *array_type;                   //`array.array`, type of the distances of `hamming_distance_pairs`.
+    PyObject *future_type;                  //`concurrent.futures.Future`, see `submit_bytes_arrays_within_dist`.
+} hexhamming_state;
+
+static inline hexhamming_state* get_state(PyObject *module) {
+    return (hexhamming_state*)PyModule_GetState(module);
+}
+
+static inline hexhamming_latency* get_latency(PyObject *module) {
+    return get_state(module)->latency;
+}
+
+static inline const hexhamming_kernels* get_kernels(PyObject *module) {
+    return get_state(module)->kernels.load(std::memory_order_acquire);
+}
+
+// C++ interface over the kernels currently selected by `set_algo`.
+static inline hexhamming::dispatcher get_dispatcher(PyObject *module) {
+    return hexhamming::dispatcher(get_kernels(module));
+}
+
+#if PY_VERSION_HEX < 0x03090000
+    // Without PyType_GetModule types find the state of the (only) module instance here.
+    static hexhamming_state *legacy_state = NULL;
+#endif
+
+static inline hexhamming_state* get_type_state(PyTypeObject *type) {
+#if PY_VERSION_HEX >= 0x03090000
+    return get_state(PyType_GetModule(type));
+#else
+    return legacy_state;
+#endif
+}
 
 
 /**
@@ -34,12 +117,6 @@ inline int check_hexstrings_within_dist(
     uint64_t string_length,
     int64_t max_dist
   ) {
-    // if both strings are the same, short circuit
-    // and return 0
-    if (strcmp(a, b) == 0) {
-      return 1;
-    }
-
     int64_t result = 0;
     int val1, val2;
     for (size_t i = 0; i < string_length; ++i) {
@@ -67,6 +144,28 @@ inline int check_hexstrings_within_dist(
     return 1;
 }
 
+/**
+ * Returns characters of a hex string straight from the `str` object. Valid hex strings are ASCII,
+ * which CPython stores one byte per char together with the length, so there is nothing to convert
+ * or measure; strings holding other chars are rejected by their kind flag without looking at the data.
+ *
+ * @param string    Python `str` object
+ * @param length    receives number of chars
+ * @returns         pointer to chars, or NULL with ValueError set
+ */
+static const char * hex_string_chars(PyObject *string, uint64_t *length) {
+#if PY_VERSION_HEX < 0x030C0000
+    if (PyUnicode_READY(string) < 0)
+        return NULL;
+#endif
+    if (!PyUnicode_IS_ASCII(string)) {
+        PyErr_SetString(PyExc_ValueError, "hex string contains invalid char");
+        return NULL;
+    }
+    *length = (uint64_t)PyUnicode_GET_LENGTH(string);
+    return (const char*)PyUnicode_DATA(string);
+}
+
 /**
  * Python interface for `hamming_distance`
  *
@@ -77,13 +176,14 @@ inline int check_hexstrings_within_dist(
  * @returns         the integer hamming distance between the binary
  */
 static PyObject * hamming_distance_string_wrapper(PyObject *self, PyObject *args) {
-    char *input_s1;
-    char *input_s2;
+    trace_scope trace(get_latency(self), ENTRY_HAMMING_DISTANCE_STRING);
+    PyObject *string1;
+    PyObject *string2;
 
     // get the two strings from `args`
-    // if they are incorrect types (i.e., not 's'), this will raise
+    // if they are incorrect types (i.e., not 'U'), this will raise
     // a ValueError
-    if (!PyArg_ParseTuple(args, "ss", &input_s1, &input_s2)) {
+    if (!PyArg_ParseTuple(args, "UU", &string1, &string2)) {
         PyErr_SetString(
             PyExc_ValueError,
             "error occurred while parsing arguments"
@@ -91,14 +191,13 @@ static PyObject * hamming_distance_string_wrapper(PyObject *self, PyObject *args
         return NULL;
     }
 
-    // if either c-string is NULL, can't move on, so raise
-    if (input_s1 == NULL || input_s2 == NULL) {
-        PyErr_SetString(PyExc_ValueError, "one or no strings provided!");
+    uint64_t input_s1_len, input_s2_len;
+    const char *input_s1 = hex_string_chars(string1, &input_s1_len);
+    if (input_s1 == NULL)
+        return NULL;
+    const char *input_s2 = hex_string_chars(string2, &input_s2_len);
+    if (input_s2 == NULL)
         return NULL;
-    }
-
-    uint64_t input_s1_len = strlen(input_s1);
-    uint64_t input_s2_len = strlen(input_s2);
 
     // if the two strings are not the same length, can't move on, so raise
     if (input_s1_len != input_s2_len) {
@@ -108,17 +207,23 @@ static PyObject * hamming_distance_string_wrapper(PyObject *self, PyObject *args
 
     // at this point, we can safely proceed with
     // our `hamming_distance` computation
-    uint64_t dist = ptr__hamming_distance_string(input_s1, input_s2, input_s1_len);
-    if (dist == UINT64_MAX) {
-        // this should only happen if the strings contain
-        // invalid hexadecimal characters
-        PyErr_SetString(PyExc_ValueError, "hex string contains invalid char");
-        return NULL;
-    } else {
+    const hexhamming::dispatcher dispatcher = get_dispatcher(self);
+    trace.kernel_start(dispatcher.kernels(), input_s1_len);
+    try {
+        uint64_t dist = dispatcher.distance(std::string_view(input_s1, input_s1_len),
+                                            std::string_view(input_s2, input_s2_len));
+        trace.kernel_end((int64_t)dist);
         // put the unsigned int64 into a Python Int object
         // and return back to the caller!
         return Py_BuildValue("K", dist);
     }
+    catch (const std::invalid_argument &error) {
+        // this should only happen if the strings contain
+        // invalid hexadecimal characters
+        trace.kernel_end(-1);
+        PyErr_SetString(PyExc_ValueError, error.what());
+        return NULL;
+    }
 }
 
 /**
@@ -131,6 +236,7 @@ static PyObject * hamming_distance_string_wrapper(PyObject *self, PyObject *args
  * @returns         the integer hamming distance between the binary
  */
 static PyObject * hamming_distance_byte_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_HAMMING_DISTANCE_BYTES);
     uint8_t *input_s1;
     uint8_t *input_s2;
     uint64_t input_s1_len = 0;
@@ -161,10 +267,154 @@ static PyObject * hamming_distance_byte_wrapper(PyObject *self, PyObject *args)
 
     // at this point, we can safely proceed with
     // our `hamming_distance` computation
-    uint64_t dist = ptr__hamming_distance_bytes(input_s1, input_s2, input_s1_len, -1);
+    const hexhamming::dispatcher dispatcher = get_dispatcher(self);
+    trace.kernel_start(dispatcher.kernels(), input_s1_len);
+    uint64_t dist = dispatcher.distance(hexhamming::bytes_view(input_s1, input_s1_len),
+                                        hexhamming::bytes_view(input_s2, input_s2_len));
+    trace.kernel_end((int64_t)dist);
     return Py_BuildValue("K", dist);
 }
 
+// One pair of `hamming_distance_pairs`, resolved while the GIL is held.
+struct distance_pair {
+    const char *a;
+    const char *b;
+    uint64_t length;
+    enum { PAIR_INVALID, PAIR_STRING, PAIR_BYTES } kind;
+};
+
+/**
+ * Resolves characters or bytes of a pair of `str` or `bytes` objects, PAIR_INVALID when they cannot be
+ * compared: mixed or other types, different lengths or non-ASCII strings. Never raises.
+ */
+static distance_pair resolve_distance_pair(PyObject *a, PyObject *b) {
+    distance_pair pair = {NULL, NULL, 0, distance_pair::PAIR_INVALID};
+    if (PyBytes_Check(a) && PyBytes_Check(b)) {
+        if (PyBytes_GET_SIZE(a) != PyBytes_GET_SIZE(b))
+            return pair;
+        pair.a = PyBytes_AS_STRING(a);
+        pair.b = PyBytes_AS_STRING(b);
+        pair.length = (uint64_t)PyBytes_GET_SIZE(a);
+        pair.kind = distance_pair::PAIR_BYTES;
+    }
+    else if (PyUnicode_Check(a) && PyUnicode_Check(b)) {
+#if PY_VERSION_HEX < 0x030C0000
+        if (PyUnicode_READY(a) < 0 || PyUnicode_READY(b) < 0) {
+            PyErr_Clear();
+            return pair;
+        }
+#endif
+        if (!PyUnicode_IS_ASCII(a) || !PyUnicode_IS_ASCII(b) || PyUnicode_GET_LENGTH(a) != PyUnicode_GET_LENGTH(b))
+            return pair;
+        pair.a = (const char*)PyUnicode_DATA(a);
+        pair.b = (const char*)PyUnicode_DATA(b);
+        pair.length = (uint64_t)PyUnicode_GET_LENGTH(a);
+        pair.kind = distance_pair::PAIR_STRING;
+    }
+    return pair;
+}
+
+/**
+ * Python interface for `hamming_distance_pairs`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `hamming_distance_pairs` interface
+ *                  - `seq_a` - sequence of hex str or bytes
+ *                  - `seq_b` - sequence of hex str or bytes, same length as `seq_a`
+ * @returns         array('q') with distance of every pair, -1 for pairs that cannot be compared.
+ */
+static PyObject * hamming_distance_pairs_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_HAMMING_DISTANCE_PAIRS);
+    PyObject *seq_a_object, *seq_b_object;
+
+    if (!PyArg_ParseTuple(args, "OO", &seq_a_object, &seq_b_object)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    PyObject *seq_a = PySequence_Fast(seq_a_object, "`seq_a` must be a sequence of str or bytes");
+    if (seq_a == NULL) {
+        PyErr_SetString(PyExc_ValueError, "`seq_a` must be a sequence of str or bytes");
+        return NULL;
+    }
+    PyObject *seq_b = PySequence_Fast(seq_b_object, "`seq_b` must be a sequence of str or bytes");
+    if (seq_b == NULL) {
+        Py_DECREF(seq_a);
+        PyErr_SetString(PyExc_ValueError, "`seq_b` must be a sequence of str or bytes");
+        return NULL;
+    }
+    // items are referenced until the end, lists may change while the GIL is released; without the GIL
+    // (free-threaded builds) they are also locked while their items are read
+    std::vector<PyObject*> pinned;
+    std::vector<distance_pair> pairs;
+    bool same_length, failed = false;
+#if PY_VERSION_HEX >= 0x030D0000
+    Py_BEGIN_CRITICAL_SECTION2(seq_a, seq_b);
+#endif
+    const Py_ssize_t number_of_pairs = PySequence_Fast_GET_SIZE(seq_a);
+    same_length = PySequence_Fast_GET_SIZE(seq_b) == number_of_pairs;
+    if (same_length) {
+        try {
+            pinned.reserve(2 * (size_t)number_of_pairs);
+            pairs.reserve((size_t)number_of_pairs);
+        }
+        catch (const std::bad_alloc&) {
+            failed = true;
+        }
+    }
+    if (same_length && !failed)
+        for (Py_ssize_t i = 0; i < number_of_pairs; i++) {
+            PyObject *a = PySequence_Fast_GET_ITEM(seq_a, i);
+            PyObject *b = PySequence_Fast_GET_ITEM(seq_b, i);
+            Py_INCREF(a);
+            Py_INCREF(b);
+            pinned.push_back(a);
+            pinned.push_back(b);
+            pairs.push_back(resolve_distance_pair(a, b));
+        }
+#if PY_VERSION_HEX >= 0x030D0000
+    Py_END_CRITICAL_SECTION2();
+#endif
+    Py_DECREF(seq_a);
+    Py_DECREF(seq_b);
+    if (!same_length) {
+        PyErr_SetString(PyExc_ValueError, "`seq_a` and `seq_b` must be the same length");
+        return NULL;
+    }
+    if (failed)
+        return PyErr_NoMemory();
+
+    // distances are written to the bytes the array is then built from, never zero-filled first
+    PyObject *result = NULL;
+    PyObject *distances = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)(pairs.size() * sizeof(int64_t)));
+    if (distances != NULL) {
+        const hexhamming_kernels* kernels = get_kernels(self);
+        int64_t *out = (int64_t*)PyBytes_AS_STRING(distances);
+        trace.kernel_start(kernels, pairs.size());
+        Py_BEGIN_ALLOW_THREADS
+        for (size_t i = 0; i < pairs.size(); i++) {
+            const distance_pair &pair = pairs[i];
+            uint64_t distance = UINT64_MAX;
+            if (pair.kind == distance_pair::PAIR_STRING)
+                distance = kernels->hamming_distance_string(pair.a, pair.b, pair.length);
+            else if (pair.kind == distance_pair::PAIR_BYTES)
+                distance = bytes_kernel_for_length(kernels, pair.length)((const uint8_t*)pair.a,
+                                                                         (const uint8_t*)pair.b, pair.length, -1);
+            out[i] = distance == UINT64_MAX ? -1 : (int64_t)distance;
+        }
+        Py_END_ALLOW_THREADS
+        trace.kernel_end((int64_t)pairs.size());
+        result = PyObject_CallFunction(get_state(self)->array_type, "sO", "q", distances);
+        Py_DECREF(distances);
+    }
+    for (PyObject *item : pinned)
+        Py_DECREF(item);
+    return result;
+}
+
 /**
  * Python interface for `check_hexstrings_within_dist`
  *
@@ -175,14 +425,15 @@ static PyObject * hamming_distance_byte_wrapper(PyObject *self, PyObject *args)
  * @returns
  */
 static PyObject * check_hexstrings_within_dist_wrapper(PyObject *self, PyObject *args) {
-    char *input_s1;
-    char *input_s2;
+    trace_scope trace(get_latency(self), ENTRY_CHECK_HEXSTRINGS_WITHIN_DIST);
+    PyObject *string1;
+    PyObject *string2;
     uint64_t max_dist;
 
     // get the two strings from `args`
-    // if they are incorrect types (i.e., not 's'), this will raise
+    // if they are incorrect types (i.e., not 'U'), this will raise
     // a ValueError
-    if (!PyArg_ParseTuple(args, "ssK", &input_s1, &input_s2, &max_dist)) {
+    if (!PyArg_ParseTuple(args, "UUK", &string1, &string2, &max_dist)) {
         PyErr_SetString(
             PyExc_ValueError,
             "error occurred while parsing arguments"
@@ -190,14 +441,13 @@ static PyObject * check_hexstrings_within_dist_wrapper(PyObject *self, PyObject
         return NULL;
     }
 
-    // if either c-string is NULL, can't move on, so raise
-    if (input_s1 == NULL || input_s2 == NULL) {
-        PyErr_SetString(PyExc_ValueError, "one or no strings provided!");
+    uint64_t input_s1_len, input_s2_len;
+    const char *input_s1 = hex_string_chars(string1, &input_s1_len);
+    if (input_s1 == NULL)
+        return NULL;
+    const char *input_s2 = hex_string_chars(string2, &input_s2_len);
+    if (input_s2 == NULL)
         return NULL;
-    }
-
-    uint64_t input_s1_len = strlen(input_s1);
-    uint64_t input_s2_len = strlen(input_s2);
 
     if (input_s1_len != input_s2_len) {
         PyErr_SetString(PyExc_ValueError, "strings are NOT the same length");
@@ -215,12 +465,14 @@ static PyObject * check_hexstrings_within_dist_wrapper(PyObject *self, PyObject
 
     // at this point, we can safely proceed with
     // our `hamming_distance` computation
+    trace.kernel_start(get_kernels(self), input_s1_len);
     int result = check_hexstrings_within_dist(
         input_s1,
         input_s2,
         input_s1_len,
         max_dist
     );
+    trace.kernel_end(result);
     if (result == -1) {
       // this should only happen if the strings contain
       // invalid hexadecimal characters
@@ -244,6 +496,7 @@ static PyObject * check_hexstrings_within_dist_wrapper(PyObject *self, PyObject
  * @returns         index of element in array_of_elems or -1.
  */
 static PyObject * check_bytes_arrays_within_dist_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_CHECK_BYTES_ARRAYS_WITHIN_DIST);
     uint8_t *big_array, *small_array;
     uint64_t big_array_size = 0;
     uint64_t small_array_size = 0;
@@ -272,30 +525,177 @@ static PyObject * check_bytes_arrays_within_dist_wrapper(PyObject *self, PyObjec
         return NULL;
     }
 
-    int res;
+    const hexhamming::dispatcher hamming = get_dispatcher(self);
+    int64_t index;
+    trace.kernel_start(hamming.kernels(), small_array_size);
+    Py_BEGIN_ALLOW_THREADS
+    index = hamming.find_within_dist(hexhamming::bytes_view(big_array, big_array_size),
+                                     hexhamming::bytes_view(small_array, small_array_size), max_dist);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(index);
+    return Py_BuildValue("L", (long long)index);
+}
+
+/**
+ * Returns Tanimoto (Jaccard) similarity from intersection and union popcounts.
+ * Two all-zero fingerprints are considered identical.
+ *
+ * @param and_count popcount(a & b)
+ * @param or_count  popcount(a | b)
+ * @return          and_count / or_count
+ */
+static inline double tanimoto_from_counts(uint64_t and_count, uint64_t or_count) {
+    if (or_count == 0)
+        return 1.0;
+    return (double)and_count / (double)or_count;
+}
+
+/**
+ * Python interface for `and_or_count_bytes`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `and_or_count_bytes` interface
+ *                  - `bytes1` -- bytes
+ *                  - `bytes2` -- bytes
+ * @returns         tuple (popcount(a & b), popcount(a | b))
+ */
+static PyObject * and_or_count_bytes_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_AND_OR_COUNT_BYTES);
+    uint8_t *input_s1;
+    uint8_t *input_s2;
+    uint64_t input_s1_len = 0;
+    uint64_t input_s2_len = 0;
+
+    if (!PyArg_ParseTuple(args, "s#s#", &input_s1, &input_s1_len, &input_s2, &input_s2_len)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (input_s1_len != input_s2_len) {
+        PyErr_SetString(PyExc_ValueError, "bytes are NOT the same length");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_kernels(self);
+    uint64_t and_count, or_count;
+    trace.kernel_start(kernels, input_s1_len);
+    kernels->and_or_popcount_bytes(input_s1, input_s2, input_s1_len, &and_count, &or_count);
+    trace.kernel_end((int64_t)and_count);
+    return Py_BuildValue("KK", and_count, or_count);
+}
+
+/**
+ * Python interface for `tanimoto_bytes`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `tanimoto_bytes` interface
+ *                  - `bytes1` -- bytes
+ *                  - `bytes2` -- bytes
+ * @returns         Tanimoto similarity as float
+ */
+static PyObject * tanimoto_bytes_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_TANIMOTO_BYTES);
+    uint8_t *input_s1;
+    uint8_t *input_s2;
+    uint64_t input_s1_len = 0;
+    uint64_t input_s2_len = 0;
+
+    if (!PyArg_ParseTuple(args, "s#s#", &input_s1, &input_s1_len, &input_s2, &input_s2_len)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (input_s1_len != input_s2_len) {
+        PyErr_SetString(PyExc_ValueError, "bytes are NOT the same length");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_kernels(self);
+    uint64_t and_count, or_count;
+    trace.kernel_start(kernels, input_s1_len);
+    kernels->and_or_popcount_bytes(input_s1, input_s2, input_s1_len, &and_count, &or_count);
+    trace.kernel_end((int64_t)and_count);
+    return PyFloat_FromDouble(tanimoto_from_counts(and_count, or_count));
+}
+
+/**
+ * Python interface for `tanimoto_bytes_arrays`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `tanimoto_bytes_arrays` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_to_compare` - bytes
+ * @returns         list with Tanimoto similarity of `elem_to_compare` to every element.
+ */
+static PyObject * tanimoto_bytes_arrays_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_TANIMOTO_BYTES_ARRAYS);
+    uint8_t *big_array, *small_array;
+    uint64_t big_array_size = 0;
+    uint64_t small_array_size = 0;
+
+    if (!PyArg_ParseTuple(args, "s#s#", &big_array, &big_array_size, &small_array, &small_array_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (small_array_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be >0");
+        return NULL;
+    }
+
+    if (big_array_size % small_array_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_to_compare`");
+        return NULL;
+    }
+
     uint64_t number_of_elements = big_array_size / small_array_size;
+    PyObject *result = PyList_New((Py_ssize_t)number_of_elements);
+    if (result == NULL)
+        return NULL;
+    const hexhamming_kernels* kernels = get_kernels(self);
+    uint64_t and_count, or_count;
     uint8_t* pBig = big_array;
+    trace.kernel_start(kernels, small_array_size);
     for (uint64_t i = 0; i < number_of_elements; i++, pBig += small_array_size) {
-        res = (int)ptr__hamming_distance_bytes(pBig, small_array, small_array_size, max_dist);
-        if (res == 1)
-            return Py_BuildValue("i", i);
+        kernels->and_or_popcount_bytes(pBig, small_array, small_array_size, &and_count, &or_count);
+        PyObject *similarity = PyFloat_FromDouble(tanimoto_from_counts(and_count, or_count));
+        if (similarity == NULL) {
+            Py_DECREF(result);
+            return NULL;
         }
-    return Py_BuildValue("i", -1);
+        PyList_SET_ITEM(result, (Py_ssize_t)i, similarity);
+    }
+    trace.kernel_end((int64_t)number_of_elements);
+    return result;
 }
 
 /**
- * Python interface for `set_algo`
+ * Python interface for `check_bytes_arrays_within_tanimoto`
  *
  * @param self      Python `self` object
- * @param args      Python arguments for `set_algo` interface
- *                  - `string` -- string with one of those: "extra","native","sse41","classic"
- * @returns         empty string if success or string with error.
+ * @param args      Python arguments for `check_bytes_arrays_within_tanimoto` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_to_compare` - bytes
+ *                  - `min_similarity` - float
+ * @returns         index of first element with similarity >= `min_similarity` or -1.
  */
-static PyObject * set_algo_wrapper(PyObject *self, PyObject *args) {
-    char *algo_name;
+static PyObject * check_bytes_arrays_within_tanimoto_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_CHECK_BYTES_ARRAYS_WITHIN_TANIMOTO);
+    uint8_t *big_array, *small_array;
+    uint64_t big_array_size = 0;
+    uint64_t small_array_size = 0;
+    double min_similarity;
 
-    // get the one string with algo name. if they are incorrect types (i.e., not 's'), this will raise a ValueError
-    if (!PyArg_ParseTuple(args, "s", &algo_name)) {
+    if (!PyArg_ParseTuple(args, "s#s#d", &big_array, &big_array_size, &small_array, &small_array_size, &min_similarity)) {
         PyErr_SetString(
             PyExc_ValueError,
             "error occurred while parsing arguments"
@@ -303,66 +703,1821 @@ static PyObject * set_algo_wrapper(PyObject *self, PyObject *args) {
         return NULL;
     }
 
-    // if either c-string is NULL, can't move on, so raise
-    if (algo_name == NULL) {
-        PyErr_SetString(PyExc_ValueError, "no string provided!");
+    if (small_array_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be >0");
         return NULL;
     }
 
-    const char *result = "";
-    if (strcmp(algo_name, "extra") == 0) {
-        if ((cpu_capabilities & bit_AVX2) == bit_AVX2) {
-            USE__EXTRA
-        }
-        else
-            result = cpu_not_support_msg;
+    if (!(min_similarity >= 0.0 && min_similarity <= 1.0)) {
+        PyErr_SetString(PyExc_ValueError, "`min_similarity` must be within [0, 1]");
+        return NULL;
     }
-#if defined(HAVE_NATIVE_POPCNT)
-    else if (strcmp(algo_name, "native") == 0) {
-        if ((cpu_capabilities & bit_POPCNT) == bit_POPCNT) {
-            USE__NATIVE
-        }
-        else
-            result = cpu_not_support_msg;
+
+    if (big_array_size % small_array_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_to_compare`");
+        return NULL;
     }
-#endif
-#if defined(CPU_X86_64)
-    else if (strcmp(algo_name, "sse41") == 0) {
-        if ((cpu_capabilities & bit_SSE41) == bit_SSE41) {
-            USE__SSE41
+
+    const hexhamming_kernels* kernels = get_kernels(self);
+    int64_t index = -1;
+    uint64_t and_count, or_count;
+    uint64_t number_of_elements = big_array_size / small_array_size;
+    uint8_t* pBig = big_array;
+    trace.kernel_start(kernels, small_array_size);
+    Py_BEGIN_ALLOW_THREADS
+    for (uint64_t i = 0; i < number_of_elements; i++, pBig += small_array_size) {
+        kernels->and_or_popcount_bytes(pBig, small_array, small_array_size, &and_count, &or_count);
+        // and / or >= min  <=>  and >= min * or, and skips the division for the common reject
+        if (or_count == 0 || (double)and_count >= min_similarity * (double)or_count) {
+            index = (int64_t)i;
+            break;
         }
-        else
-            result = cpu_not_support_msg;
-    }
-#endif
-    else if (strcmp(algo_name, "classic") == 0) {
-        USE__CLASSIC
     }
-    else
-        result = "Library was built without this algorithm.";
-    return Py_BuildValue("s", result);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(index);
+    return Py_BuildValue("L", (long long)index);
 }
 
-///////////////////////////////////////////////////////////////
-// Docstrings
-///////////////////////////////////////////////////////////////
-static char hamming_string_docstring[] =
-    "Calculate the hamming distance of two strings\n\n"
-    "This is equivalent to\n\n"
-    "    bin(int(a, 16) ^ int(b, 16)).count('1')\n\n"
-    "with the only difference being it was written in C and optimized\n"
-    "using a lookup table of pre-calculated hexadecimal hamming distances.\n"
-    ":param a: hexadecimal string\n"
-    ":type a: str\n"
-    ":param b: hexadecimal string\n"
-    ":type b: str\n"
-    ":returns: the hamming distance between the bits of two hexadecimal strings\n"
-    ":rtype: int\n"
-    ":raises ValueError: if either string doesn't exist, "
-    "if the strings are different lengths, or if the strings aren't valid hex";
+/**
+ * Python interface for `bitslice_bytes_array`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `bitslice_bytes_array` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_size` - size of one element in bytes
+ * @returns         bytes with elements in bit-sliced layout.
+ */
+static PyObject * bitslice_bytes_array_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_BITSLICE_BYTES_ARRAY);
+    uint8_t *big_array;
+    uint64_t big_array_size = 0;
+    Py_ssize_t elem_size;
 
+    if (!PyArg_ParseTuple(args, "s#n", &big_array, &big_array_size, &elem_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
 
-static char hamming_byte_docstring[] =
+    if (elem_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_size` must be >0");
+        return NULL;
+    }
+
+    if (big_array_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_size`");
+        return NULL;
+    }
+
+    uint64_t number_of_elements = big_array_size / elem_size;
+    uint64_t sliced_size = bitsliced_size(number_of_elements, elem_size);
+    PyObject *result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)sliced_size);
+    if (result == NULL)
+        return NULL;
+    uint8_t *sliced = (uint8_t*)PyBytes_AS_STRING(result);
+    memset(sliced, 0, sliced_size);
+    trace.kernel_start(get_kernels(self), (uint64_t)elem_size);
+    bitslice_bytes_array(big_array, number_of_elements, elem_size, sliced);
+    trace.kernel_end((int64_t)number_of_elements);
+    return result;
+}
+
+/**
+ * Python interface for `check_bitsliced_within_dist`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `check_bitsliced_within_dist` interface
+ *                  - `bitsliced_array` - bytes returned by `bitslice_bytes_array`
+ *                  - `number_of_elems` - number of elements in `bitsliced_array`
+ *                  - `elem_to_compare` - bytes
+ *                  - `max_dist` - int64
+ * @returns         index of element in bitsliced_array or -1.
+ */
+static PyObject * check_bitsliced_within_dist_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_CHECK_BITSLICED_WITHIN_DIST);
+    uint8_t *sliced, *small_array;
+    uint64_t sliced_size = 0;
+    uint64_t small_array_size = 0;
+    Py_ssize_t number_of_elements;
+    int64_t max_dist;
+
+    if (!PyArg_ParseTuple(args, "s#ns#L", &sliced, &sliced_size, &number_of_elements,
+                          &small_array, &small_array_size, &max_dist)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (small_array_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be >0");
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    if (number_of_elements < 0 || !is_bitsliced_size(sliced_size, (uint64_t)number_of_elements, small_array_size)) {
+        PyErr_SetString(PyExc_ValueError, "`bitsliced_array` size does not match `number_of_elems` and `elem_to_compare`");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_kernels(self);
+    int64_t res;
+    trace.kernel_start(kernels, small_array_size);
+    Py_BEGIN_ALLOW_THREADS
+    res = kernels->bitsliced_within_dist(sliced, number_of_elements, small_array_size, small_array, max_dist);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(res);
+    return Py_BuildValue("L", (long long)res);
+}
+
+/**
+ * Python interface for `variance_permutation`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `variance_permutation` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_size` - size of one element in bytes
+ *                  - `sample_size` - optional maximum number of elements measured
+ * @returns         list of byte positions, most discriminative first.
+ */
+static PyObject * variance_permutation_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_VARIANCE_PERMUTATION);
+    uint8_t *big_array;
+    uint64_t big_array_size = 0;
+    Py_ssize_t elem_size;
+    Py_ssize_t sample_size = 4096;
+
+    if (!PyArg_ParseTuple(args, "s#n|n", &big_array, &big_array_size, &elem_size, &sample_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (elem_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_size` must be >0");
+        return NULL;
+    }
+
+    if (sample_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`sample_size` must be >0");
+        return NULL;
+    }
+
+    if (big_array_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_size`");
+        return NULL;
+    }
+
+    // an empty array takes any `elem_size`, its permutation and per-bit counts must still fit in memory
+    if ((uint64_t)elem_size > PY_SSIZE_T_MAX / (8 * sizeof(uint64_t)))
+        return PyErr_NoMemory();
+
+    std::vector<uint64_t> permutation;
+    bool failed = false;
+    trace.kernel_start(get_kernels(self), (uint64_t)elem_size);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        permutation.resize((size_t)elem_size);
+        variance_permutation_bytes(big_array, big_array_size / elem_size, (uint64_t)elem_size,
+                                   (uint64_t)sample_size, permutation.data());
+    }
+    catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(failed ? -1 : (int64_t)permutation[0]);
+    if (failed)
+        return PyErr_NoMemory();
+
+    PyObject *result = PyList_New(elem_size);
+    if (result != NULL)
+        for (Py_ssize_t i = 0; i < elem_size; i++) {
+            PyObject *position = PyLong_FromUnsignedLongLong(permutation[i]);
+            if (position == NULL) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, i, position);
+        }
+    return result;
+}
+
+/**
+ * Python interface for `permute_bytes_array`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `permute_bytes_array` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `permutation` - sequence of byte positions, one per byte of an element
+ * @returns         bytes with bytes of every element reordered.
+ */
+static PyObject * permute_bytes_array_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_PERMUTE_BYTES_ARRAY);
+    uint8_t *big_array;
+    uint64_t big_array_size = 0;
+    PyObject *permutation_object;
+
+    if (!PyArg_ParseTuple(args, "s#O", &big_array, &big_array_size, &permutation_object)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    PyObject *permutation_sequence = PySequence_Fast(permutation_object, "`permutation` must be a sequence of int");
+    if (permutation_sequence == NULL) {
+        PyErr_SetString(PyExc_ValueError, "`permutation` must be a sequence of int");
+        return NULL;
+    }
+    // without the GIL (free-threaded builds) the list is locked while its items are read
+    std::vector<uint64_t> permutation;
+    bool failed = false;
+#if PY_VERSION_HEX >= 0x030D0000
+    Py_BEGIN_CRITICAL_SECTION(permutation_sequence);
+#endif
+    const Py_ssize_t size = PySequence_Fast_GET_SIZE(permutation_sequence);
+    try {
+        permutation.resize((size_t)size);
+    }
+    catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    for (Py_ssize_t i = 0; !failed && i < size; i++) {
+        permutation[i] = PyLong_AsUnsignedLongLong(PySequence_Fast_GET_ITEM(permutation_sequence, i));
+        failed = PyErr_Occurred() != NULL;
+    }
+#if PY_VERSION_HEX >= 0x030D0000
+    Py_END_CRITICAL_SECTION();
+#endif
+    Py_DECREF(permutation_sequence);
+    if (failed) {
+        if (PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "`permutation` must be a sequence of int");
+        else
+            PyErr_NoMemory();
+        return NULL;
+    }
+    const Py_ssize_t elem_size = (Py_ssize_t)permutation.size();
+
+    if (elem_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`permutation` must not be empty");
+        return NULL;
+    }
+
+    if (!is_byte_permutation(permutation.data(), (uint64_t)elem_size)) {
+        PyErr_SetString(PyExc_ValueError, "`permutation` must hold every position of an element once");
+        return NULL;
+    }
+
+    if (big_array_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `permutation` size");
+        return NULL;
+    }
+
+    PyObject *result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)big_array_size);
+    if (result == NULL)
+        return NULL;
+    uint8_t *permuted = (uint8_t*)PyBytes_AS_STRING(result);
+    trace.kernel_start(get_kernels(self), (uint64_t)elem_size);
+    Py_BEGIN_ALLOW_THREADS
+    permute_bytes_array(big_array, big_array_size / elem_size, (uint64_t)elem_size, permutation.data(), permuted);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end((int64_t)(big_array_size / elem_size));
+    return result;
+}
+
+/**
+ * Parses arguments shared by `distance_histogram` and `count_within_dist`:
+ * packed array, one or more queries and optional size of one element.
+ *
+ * @returns         0 on success, -1 with ValueError set otherwise.
+ */
+static int parse_multi_query_args(uint64_t big_array_size, uint64_t queries_size, Py_ssize_t elem_size,
+                                  uint64_t *out_elem_size, uint64_t *out_number_of_elements,
+                                  uint64_t *out_number_of_queries) {
+    if (elem_size < 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_size` must be >0");
+        return -1;
+    }
+
+    if (elem_size == 0)
+        elem_size = (Py_ssize_t)queries_size;
+
+    if (elem_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be >0");
+        return -1;
+    }
+
+    if (queries_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be multiplier of `elem_size`");
+        return -1;
+    }
+
+    if (big_array_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_to_compare`");
+        return -1;
+    }
+
+    *out_elem_size = (uint64_t)elem_size;
+    *out_number_of_elements = big_array_size / elem_size;
+    *out_number_of_queries = queries_size / elem_size;
+    return 0;
+}
+
+/**
+ * Python interface for `distance_histogram`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `distance_histogram` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_to_compare` - bytes, one or more queries
+ *                  - `elem_size` - optional size of one element, defaults to size of `elem_to_compare`
+ * @returns         list, item `d` is number of (element, query) pairs at distance `d`.
+ */
+static PyObject * distance_histogram_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_DISTANCE_HISTOGRAM);
+    uint8_t *big_array, *queries;
+    uint64_t big_array_size = 0;
+    uint64_t queries_size = 0;
+    Py_ssize_t elem_size = 0;
+
+    if (!PyArg_ParseTuple(args, "s#s#|n", &big_array, &big_array_size, &queries, &queries_size, &elem_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    uint64_t size, number_of_elements, number_of_queries;
+    if (parse_multi_query_args(big_array_size, queries_size, elem_size,
+                               &size, &number_of_elements, &number_of_queries) < 0)
+        return NULL;
+
+    uint64_t number_of_buckets = size * 8 + 1;
+    uint64_t *histogram = (uint64_t*)PyMem_Calloc(number_of_buckets, sizeof(uint64_t));
+    if (histogram == NULL)
+        return PyErr_NoMemory();
+    const hexhamming_kernels* kernels = get_kernels(self);
+    trace.kernel_start(kernels, size);
+    Py_BEGIN_ALLOW_THREADS
+    distance_histogram_bytes(bytes_kernel_for_length(kernels, size), big_array, number_of_elements, queries,
+                             number_of_queries, size, histogram);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end((int64_t)(number_of_elements * number_of_queries));
+
+    PyObject *result = PyList_New((Py_ssize_t)number_of_buckets);
+    if (result != NULL)
+        for (uint64_t i = 0; i < number_of_buckets; i++) {
+            PyObject *count = PyLong_FromUnsignedLongLong(histogram[i]);
+            if (count == NULL) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, (Py_ssize_t)i, count);
+        }
+    PyMem_Free(histogram);
+    return result;
+}
+
+/**
+ * Python interface for `count_within_dist`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `count_within_dist` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_to_compare` - bytes, one or more queries
+ *                  - `max_dist` - int64
+ *                  - `elem_size` - optional size of one element, defaults to size of `elem_to_compare`
+ * @returns         number of (element, query) pairs within `max_dist`.
+ */
+static PyObject * count_within_dist_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_COUNT_WITHIN_DIST);
+    uint8_t *big_array, *queries;
+    uint64_t big_array_size = 0;
+    uint64_t queries_size = 0;
+    int64_t max_dist;
+    Py_ssize_t elem_size = 0;
+
+    if (!PyArg_ParseTuple(args, "s#s#L|n", &big_array, &big_array_size, &queries, &queries_size,
+                          &max_dist, &elem_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    uint64_t size, number_of_elements, number_of_queries;
+    if (parse_multi_query_args(big_array_size, queries_size, elem_size,
+                               &size, &number_of_elements, &number_of_queries) < 0)
+        return NULL;
+
+    const hexhamming_kernels* kernels = get_kernels(self);
+    uint64_t count = 0;
+    trace.kernel_start(kernels, size);
+    Py_BEGIN_ALLOW_THREADS
+    count = count_within_dist_bytes(bytes_kernel_for_length(kernels, size), big_array, number_of_elements, queries,
+                                    number_of_queries, size, max_dist);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end((int64_t)count);
+    return Py_BuildValue("K", count);
+}
+
+static void collect_sliding_match(void *context, const uint64_t offset, const uint64_t distance) {
+    ((std::vector<std::pair<uint64_t, uint64_t>>*)context)->emplace_back(offset, distance);
+}
+
+/**
+ * Python interface for `sliding_hamming`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `sliding_hamming` interface
+ *                  - `stream` - bytes
+ *                  - `pattern` - bytes
+ *                  - `max_dist` - int64
+ *                  - `bit_granularity` - optional bool, report bit offsets instead of byte offsets
+ * @returns         list of (offset, distance) tuples for every offset within `max_dist`.
+ */
+static PyObject * sliding_hamming_wrapper(PyObject *self, PyObject *args, PyObject *kwds) {
+    trace_scope trace(get_latency(self), ENTRY_SLIDING_HAMMING);
+    uint8_t *stream, *pattern;
+    uint64_t stream_size = 0;
+    uint64_t pattern_size = 0;
+    int64_t max_dist;
+    int bit_granularity = 0;
+    static const char *kwlist[] = {"stream", "pattern", "max_dist", "bit_granularity", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s#s#L|p", (char**)kwlist, &stream, &stream_size,
+                                     &pattern, &pattern_size, &max_dist, &bit_granularity)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (pattern_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`pattern` must not be empty");
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    const int shifts = bit_granularity ? SLIDING_MAX_SHIFTS : 1;
+    const hexhamming_kernels* kernels = get_kernels(self);
+    std::vector<std::pair<uint64_t, uint64_t>> matches;
+    bool failed = false;
+    trace.kernel_start(kernels, pattern_size);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        std::vector<uint8_t> patterns(shifts * (pattern_size + 1)), masks(shifts * (pattern_size + 1));
+        for (int shift = 0; shift < shifts; shift++)
+            sliding_shift_pattern(pattern, pattern_size, shift, &patterns[shift * (pattern_size + 1)],
+                                  &masks[shift * (pattern_size + 1)]);
+        kernels->sliding_hamming(stream, stream_size, patterns.data(), masks.data(), pattern_size, shifts,
+                                 (uint64_t)max_dist, collect_sliding_match, &matches);
+    }
+    catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(failed ? -1 : (int64_t)matches.size());
+    if (failed)
+        return PyErr_NoMemory();
+
+    PyObject *result = PyList_New((Py_ssize_t)matches.size());
+    if (result == NULL)
+        return NULL;
+    for (size_t i = 0; i < matches.size(); i++) {
+        PyObject *match = Py_BuildValue("(KK)", matches[i].first, matches[i].second);
+        if (match == NULL) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        PyList_SET_ITEM(result, (Py_ssize_t)i, match);
+    }
+    return result;
+}
+
+// Arrow style offsets of `number_of_records` records are non-decreasing and inside `data_size` bytes.
+template <typename offset_t>
+static bool offsets_valid(const offset_t *offsets, const uint64_t number_of_records, const uint64_t data_size) {
+    if (offsets[0] < 0 || (uint64_t)offsets[number_of_records] > data_size)
+        return false;
+    bool valid = true;
+    for (uint64_t i = 0; i < number_of_records; i++)
+        valid &= offsets[i] <= offsets[i + 1];
+    return valid;
+}
+
+/**
+ * Searches every query among records of its own length, see `check_bytes_offsets_within_dist`.
+ * Queries are grouped by length, each group has its own kernel. Records are visited once, each is
+ * compared with the queries of its length which have no match yet.
+ *
+ * @returns         false if offsets are invalid
+ */
+template <typename offset_t>
+static bool find_within_dist_offsets(const hexhamming_kernels *kernels, const uint8_t *data, const uint64_t data_size,
+                                     const offset_t *offsets, const uint64_t number_of_records,
+                                     const std::vector<Py_buffer> &queries, const int64_t max_dist,
+                                     std::vector<int64_t> &found) {
+    if (!offsets_valid(offsets, number_of_records, data_size))
+        return false;
+    // group `g` holds the queries of the g-th shortest distinct length
+    std::vector<uint64_t> lengths;
+    lengths.reserve(queries.size());
+    for (const Py_buffer &query : queries)
+        lengths.push_back((uint64_t)query.len);
+    std::sort(lengths.begin(), lengths.end());
+    lengths.erase(std::unique(lengths.begin(), lengths.end()), lengths.end());
+    std::vector<std::vector<size_t>> pending(lengths.size());
+    std::vector<hamming_distance_bytes_fn> group_kernels;
+    group_kernels.reserve(lengths.size());
+    for (const uint64_t length : lengths)
+        group_kernels.push_back(bytes_kernel_for_length(kernels, length));
+    for (size_t q = 0; q < queries.size(); q++)
+        pending[std::lower_bound(lengths.begin(), lengths.end(), (uint64_t)queries[q].len) - lengths.begin()]
+            .push_back(q);
+
+    size_t remaining = queries.size();
+    for (uint64_t i = 0; i < number_of_records && remaining > 0; i++) {
+        const uint64_t length = (uint64_t)(offsets[i + 1] - offsets[i]);
+        const std::vector<uint64_t>::const_iterator match = std::lower_bound(lengths.begin(), lengths.end(), length);
+        if (match == lengths.end() || *match != length)
+            continue;
+        std::vector<size_t> &group = pending[match - lengths.begin()];
+        const hamming_distance_bytes_fn distance = group_kernels[match - lengths.begin()];
+        const uint8_t *record = data + offsets[i];
+        for (size_t k = 0; k < group.size();) {
+            if (distance(record, (const uint8_t*)queries[group[k]].buf, length, max_dist) == 1) {
+                found[group[k]] = (int64_t)i;
+                group[k] = group.back();
+                group.pop_back();
+                remaining--;
+            }
+            else {
+                k++;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Python interface for `check_bytes_offsets_within_dist`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `check_bytes_offsets_within_dist` interface
+ *                  - `data` - bytes, concatenated records
+ *                  - `offsets` - buffer of int32 or int64, record `i` is `data[offsets[i]:offsets[i + 1]]`
+ *                  - `elems_to_compare` - sequence of bytes
+ *                  - `max_dist` - int64
+ * @returns         list with index of first record within `max_dist` of every query or -1.
+ */
+static PyObject * check_bytes_offsets_within_dist_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_CHECK_BYTES_OFFSETS_WITHIN_DIST);
+    uint8_t *data;
+    uint64_t data_size = 0;
+    PyObject *offsets_object, *queries_object;
+    int64_t max_dist;
+
+    if (!PyArg_ParseTuple(args, "s#OOL", &data, &data_size, &offsets_object, &queries_object, &max_dist)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    Py_buffer offsets;
+    if (PyObject_GetBuffer(offsets_object, &offsets, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+        PyErr_SetString(PyExc_ValueError, "`offsets` must be a buffer of int32 or int64");
+        return NULL;
+    }
+    const char *format = offsets.format == NULL ? "B" : offsets.format;
+    if (*format == '@' || *format == '=')
+        format++;
+    if (!(format[0] != '\0' && format[1] == '\0' && strchr("ilq", format[0]) != NULL &&
+          (offsets.itemsize == 4 || offsets.itemsize == 8))) {
+        PyBuffer_Release(&offsets);
+        PyErr_SetString(PyExc_ValueError, "`offsets` must be a buffer of int32 or int64");
+        return NULL;
+    }
+    if (offsets.len < offsets.itemsize) {
+        PyBuffer_Release(&offsets);
+        PyErr_SetString(PyExc_ValueError, "`offsets` must hold at least one value");
+        return NULL;
+    }
+    const uint64_t number_of_records = (uint64_t)(offsets.len / offsets.itemsize) - 1;
+
+    PyObject *queries_sequence = PySequence_Fast(queries_object, "`elems_to_compare` must be a sequence of bytes");
+    if (queries_sequence == NULL) {
+        PyBuffer_Release(&offsets);
+        PyErr_SetString(PyExc_ValueError, "`elems_to_compare` must be a sequence of bytes");
+        return NULL;
+    }
+    // buffers keep the queries alive; without the GIL (free-threaded builds) the list is locked while
+    // its items are read
+    std::vector<Py_buffer> queries;
+    Py_ssize_t number_of_queries = 0, acquired = 0;
+    bool no_memory = false;
+#if PY_VERSION_HEX >= 0x030D0000
+    Py_BEGIN_CRITICAL_SECTION(queries_sequence);
+#endif
+    number_of_queries = PySequence_Fast_GET_SIZE(queries_sequence);
+    try {
+        queries.resize((size_t)number_of_queries);
+    }
+    catch (const std::bad_alloc&) {
+        no_memory = true;
+    }
+    for (; !no_memory && acquired < number_of_queries; acquired++)
+        if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(queries_sequence, acquired), &queries[acquired],
+                               PyBUF_SIMPLE) < 0)
+            break;
+#if PY_VERSION_HEX >= 0x030D0000
+    Py_END_CRITICAL_SECTION();
+#endif
+
+    PyObject *result = NULL;
+    if (no_memory) {
+        PyErr_NoMemory();
+    }
+    else if (acquired < number_of_queries) {
+        PyErr_SetString(PyExc_ValueError, "`elems_to_compare` must be a sequence of bytes");
+    }
+    else {
+        const hexhamming_kernels* kernels = get_kernels(self);
+        std::vector<int64_t> found((size_t)number_of_queries, -1);
+        bool valid = true, failed = false;
+        trace.kernel_start(kernels, data_size);
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            if (offsets.itemsize == 4)
+                valid = find_within_dist_offsets(kernels, data, data_size, (const int32_t*)offsets.buf,
+                                                 number_of_records, queries, max_dist, found);
+            else
+                valid = find_within_dist_offsets(kernels, data, data_size, (const int64_t*)offsets.buf,
+                                                 number_of_records, queries, max_dist, found);
+        }
+        catch (const std::bad_alloc&) {
+            failed = true;
+        }
+        Py_END_ALLOW_THREADS
+        // index found for the first query
+        trace.kernel_end(failed || !valid || found.empty() ? -1 : found[0]);
+        if (failed) {
+            PyErr_NoMemory();
+        }
+        else if (!valid) {
+            PyErr_SetString(PyExc_ValueError, "`offsets` must be non-decreasing and within `data`");
+        }
+        else if ((result = PyList_New(number_of_queries)) != NULL) {
+            for (Py_ssize_t q = 0; q < number_of_queries; q++) {
+                PyObject *index = PyLong_FromLongLong((long long)found[q]);
+                if (index == NULL) {
+                    Py_CLEAR(result);
+                    break;
+                }
+                PyList_SET_ITEM(result, q, index);
+            }
+        }
+    }
+
+    for (Py_ssize_t q = 0; q < acquired; q++)
+        PyBuffer_Release(&queries[q]);
+    Py_DECREF(queries_sequence);
+    PyBuffer_Release(&offsets);
+    return result;
+}
+
+/**
+ * Acquires C contiguous float32 buffer of `object`.
+ *
+ * @returns         0 on success, -1 with ValueError `message` set otherwise.
+ */
+static int get_float32_buffer(PyObject *object, Py_buffer *buffer, const char *message) {
+    if (PyObject_GetBuffer(object, buffer, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+        PyErr_SetString(PyExc_ValueError, message);
+        return -1;
+    }
+    const char *format = buffer->format == NULL ? "B" : buffer->format;
+    if (*format == '@' || *format == '=')
+        format++;
+    if (strcmp(format, "f") != 0 || buffer->itemsize != 4) {
+        PyBuffer_Release(buffer);
+        PyErr_SetString(PyExc_ValueError, message);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Python interface for `hamming_rerank`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `hamming_rerank` interface
+ *                  - `array_of_elems` - bytes, binary codes
+ *                  - `elem_to_compare` - bytes, binary code of the query
+ *                  - `vectors` - buffer of float32, one vector per element
+ *                  - `query_vector` - buffer of float32
+ *                  - `k` - number of results
+ *                  - `candidates` - optional size of the Hamming shortlist, 0 for no limit
+ *                  - `max_dist` - optional Hamming radius of the shortlist, -1 for no limit
+ *                  - `metric` - optional "dot" or "l2"
+ * @returns         list of up to `k` (index, score) tuples, best first.
+ */
+static PyObject * hamming_rerank_wrapper(PyObject *self, PyObject *args, PyObject *kwds) {
+    trace_scope trace(get_latency(self), ENTRY_HAMMING_RERANK);
+    uint8_t *big_array, *small_array;
+    uint64_t big_array_size = 0;
+    uint64_t small_array_size = 0;
+    PyObject *vectors_object, *query_vector_object;
+    Py_ssize_t k;
+    Py_ssize_t candidates = 0;
+    int64_t max_dist = -1;
+    const char *metric_name = "dot";
+    static const char *kwlist[] = {"array_of_elems", "elem_to_compare", "vectors", "query_vector", "k",
+                                   "candidates", "max_dist", "metric", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s#s#OOn|nLs", (char**)kwlist, &big_array, &big_array_size,
+                                     &small_array, &small_array_size, &vectors_object, &query_vector_object, &k,
+                                     &candidates, &max_dist, &metric_name)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (small_array_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be >0");
+        return NULL;
+    }
+
+    if (big_array_size % small_array_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_to_compare`");
+        return NULL;
+    }
+
+    if (k <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`k` must be >0");
+        return NULL;
+    }
+
+    if (candidates < 0) {
+        PyErr_SetString(PyExc_ValueError, "`candidates` must be >=0");
+        return NULL;
+    }
+
+    if (max_dist < -1) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0 or -1");
+        return NULL;
+    }
+
+    vector_metric metric;
+    if (strcmp(metric_name, "dot") == 0) {
+        metric = VECTOR_DOT;
+    }
+    else if (strcmp(metric_name, "l2") == 0) {
+        metric = VECTOR_L2;
+    }
+    else {
+        PyErr_SetString(PyExc_ValueError, "`metric` must be \"dot\" or \"l2\"");
+        return NULL;
+    }
+
+    Py_buffer vectors, query_vector;
+    if (get_float32_buffer(vectors_object, &vectors, "`vectors` must be a buffer of float32") < 0)
+        return NULL;
+    if (get_float32_buffer(query_vector_object, &query_vector, "`query_vector` must be a buffer of float32") < 0) {
+        PyBuffer_Release(&vectors);
+        return NULL;
+    }
+
+    const uint64_t number_of_elements = big_array_size / small_array_size;
+    const uint64_t dimensions = (uint64_t)(query_vector.len / 4);
+    PyObject *result = NULL;
+    if (dimensions == 0) {
+        PyErr_SetString(PyExc_ValueError, "`query_vector` must not be empty");
+    }
+    else if ((uint64_t)(vectors.len / 4) != number_of_elements * dimensions) {
+        PyErr_SetString(PyExc_ValueError, "`vectors` must hold one vector of `query_vector` size per element");
+    }
+    else {
+        const hexhamming_kernels* kernels = get_kernels(self);
+        std::vector<std::pair<float, uint64_t>> ranked;
+        bool failed = false;
+        trace.kernel_start(kernels, small_array_size);
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            std::vector<std::pair<uint64_t, uint64_t>> shortlist;
+            hamming_shortlist(kernels, big_array, number_of_elements, small_array, small_array_size,
+                              (uint64_t)candidates, max_dist, shortlist);
+            rerank_shortlist(kernels, shortlist, (const float*)vectors.buf, (const float*)query_vector.buf,
+                             dimensions, metric, (uint64_t)k, ranked);
+        }
+        catch (const std::bad_alloc&) {
+            failed = true;
+        }
+        Py_END_ALLOW_THREADS
+        // index of the best element
+        trace.kernel_end(failed || ranked.empty() ? -1 : (int64_t)ranked[0].second);
+        if (failed) {
+            PyErr_NoMemory();
+        }
+        else if ((result = PyList_New((Py_ssize_t)ranked.size())) != NULL) {
+            for (size_t i = 0; i < ranked.size(); i++) {
+                PyObject *item = Py_BuildValue("(Kd)", (unsigned long long)ranked[i].second,
+                                               (double)ranked[i].first);
+                if (item == NULL) {
+                    Py_CLEAR(result);
+                    break;
+                }
+                PyList_SET_ITEM(result, (Py_ssize_t)i, item);
+            }
+        }
+    }
+    PyBuffer_Release(&query_vector);
+    PyBuffer_Release(&vectors);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////
+// Asynchronous search
+///////////////////////////////////////////////////////////////
+
+/**
+ * One `submit_bytes_arrays_within_dist` call. Holds references to the future and to both
+ * bytes objects until the future is completed.
+ */
+struct search_request {
+    PyObject *future;
+    PyObject *array_object;
+    PyObject *query_object;
+    const uint8_t *array;
+    uint64_t number_of_elements;
+    const uint8_t *query;
+    uint64_t elem_size;
+    int64_t max_dist;
+    const hexhamming_kernels *kernels;
+    PyInterpreterState *interp;
+    hexhamming_pending *pending;
+    int64_t index;
+};
+
+/**
+ * Queue of submitted requests. Worker takes the oldest request together with all queued requests
+ * against the same array, so they are answered with one pass over the array.
+ */
+class search_batcher {
+public:
+    static search_batcher& instance() {
+        static search_batcher* batcher = new search_batcher();
+        return *batcher;
+    }
+
+    void push(search_request *request) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(request);
+    }
+
+    std::vector<search_request*> pop_batch() {
+        std::vector<search_request*> batch;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty())
+            return batch;
+        const search_request *first = queue.front();
+        std::vector<search_request*> rest;
+        for (search_request *request : queue) {
+            if (request->array == first->array && request->number_of_elements == first->number_of_elements &&
+                request->elem_size == first->elem_size && request->kernels == first->kernels &&
+                request->interp == first->interp)
+                batch.push_back(request);
+            else
+                rest.push_back(request);
+        }
+        queue.swap(rest);
+        return batch;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<search_request*> queue;
+};
+
+/**
+ * Scans array once for all requests of a batch: every record is compared with every query
+ * still without a match. A single request is answered by `find_within_dist` with its batch kernels.
+ */
+static void search_batch_scan(const std::vector<search_request*>& batch) {
+    if (batch.empty())
+        return;
+    search_request *first = batch.front();
+    const uint64_t elem_size = first->elem_size;
+    if (batch.size() == 1) {
+        first->index = find_within_dist(first->kernels, first->array, first->number_of_elements, first->query,
+                                        elem_size, first->max_dist);
+        return;
+    }
+    const hamming_distance_bytes_fn distance = bytes_kernel_for_length(first->kernels, elem_size);
+    std::vector<search_request*> active(batch);
+    const uint8_t *record = first->array;
+    for (uint64_t i = 0; i < first->number_of_elements && !active.empty(); i++, record += elem_size)
+        for (size_t k = 0; k < active.size();) {
+            if (distance(record, active[k]->query, elem_size, active[k]->max_dist) == 1) {
+                active[k]->index = (int64_t)i;
+                active[k] = active.back();
+                active.pop_back();
+            }
+            else
+                k++;
+        }
+}
+
+static void release_search_request(search_request *request) {
+    Py_DECREF(request->future);
+    Py_DECREF(request->array_object);
+    Py_DECREF(request->query_object);
+}
+
+/**
+ * Pool task: runs one batch of queued requests. GIL (or the interpreter in free-threaded build)
+ * is held only to start and to complete the futures, the scan itself runs detached.
+ */
+static void run_search_batch() {
+    std::vector<search_request*> batch = search_batcher::instance().pop_batch();
+    if (batch.empty())
+        return;
+    PyThreadState *tstate = PyThreadState_New(batch.front()->interp);
+    PyEval_RestoreThread(tstate);
+
+    std::vector<search_request*> running;
+    std::vector<search_request*> finished;
+    for (search_request *request : batch) {
+        PyObject *started = PyObject_CallMethod(request->future, "set_running_or_notify_cancel", NULL);
+        if (started == NULL)
+            PyErr_WriteUnraisable(request->future);
+        if (started == Py_True)
+            running.push_back(request);
+        else
+            finished.push_back(request);
+        Py_XDECREF(started);
+    }
+
+    PyEval_SaveThread();
+    for (const search_request *request : running)
+        trace_kernel_start(ENTRY_SUBMIT_BYTES_ARRAYS_WITHIN_DIST, request->kernels, request->elem_size);
+    search_batch_scan(running);
+    for (const search_request *request : running)
+        trace_kernel_end(ENTRY_SUBMIT_BYTES_ARRAYS_WITHIN_DIST, request->index);
+    PyEval_RestoreThread(tstate);
+
+    for (search_request *request : running) {
+        PyObject *done = PyObject_CallMethod(request->future, "set_result", "L", (long long)request->index);
+        if (done == NULL)
+            PyErr_WriteUnraisable(request->future);
+        Py_XDECREF(done);
+        finished.push_back(request);
+    }
+    for (search_request *request : finished)
+        release_search_request(request);
+
+    PyThreadState_Clear(tstate);
+    PyThreadState_DeleteCurrent();
+    for (search_request *request : finished) {
+        request->pending->done();
+        delete request;
+    }
+}
+
+/**
+ * Python interface for `submit_bytes_arrays_within_dist`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `submit_bytes_arrays_within_dist` interface
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_to_compare` - bytes
+ *                  - `max_dist` - int64
+ * @returns         `concurrent.futures.Future` completed with index of element in array_of_elems or -1.
+ */
+static PyObject * submit_bytes_arrays_within_dist_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_SUBMIT_BYTES_ARRAYS_WITHIN_DIST);
+    PyObject *array_object, *query_object;
+    int64_t max_dist;
+
+    if (!PyArg_ParseTuple(args, "SSL", &array_object, &query_object, &max_dist)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    uint64_t big_array_size = (uint64_t)PyBytes_GET_SIZE(array_object);
+    uint64_t small_array_size = (uint64_t)PyBytes_GET_SIZE(query_object);
+
+    if (small_array_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be >0");
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    if (big_array_size % small_array_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_to_compare`");
+        return NULL;
+    }
+
+    PyObject *future = PyObject_CallObject(get_state(self)->future_type, NULL);
+    if (future == NULL)
+        return NULL;
+
+    search_request *request = new search_request();
+    Py_INCREF(future);
+    Py_INCREF(array_object);
+    Py_INCREF(query_object);
+    request->future = future;
+    request->array_object = array_object;
+    request->query_object = query_object;
+    request->array = (const uint8_t*)PyBytes_AS_STRING(array_object);
+    request->number_of_elements = big_array_size / small_array_size;
+    request->query = (const uint8_t*)PyBytes_AS_STRING(query_object);
+    request->elem_size = small_array_size;
+    request->max_dist = max_dist;
+    request->kernels = get_kernels(self);
+    request->interp = PyInterpreterState_Get();
+    request->pending = get_state(self)->pending;
+    request->index = -1;
+
+    request->pending->add();
+    search_batcher::instance().push(request);
+    hexhamming_thread_pool::instance().submit(run_search_batch);
+    return future;
+}
+
+/**
+ * Registered in `atexit`: waits until all submitted requests of the module are completed.
+ */
+static PyObject * wait_for_pending_wrapper(PyObject *self, PyObject *unused) {
+    hexhamming_pending *pending = get_state(self)->pending;
+    Py_BEGIN_ALLOW_THREADS
+    pending->wait();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef wait_for_pending_def = {
+    "_wait_for_pending", wait_for_pending_wrapper, METH_NOARGS, NULL
+};
+
+///////////////////////////////////////////////////////////////
+// HammingIndex type
+///////////////////////////////////////////////////////////////
+
+typedef struct {
+    PyObject_HEAD
+    hexhamming_index *index;
+} HammingIndexObject;
+
+static PyObject * HammingIndex_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    hexhamming_state *state = get_type_state(type);
+    trace_scope trace(state->latency, ENTRY_HAMMING_INDEX_NEW);
+    Py_ssize_t elem_size;
+    Py_ssize_t segment_size = 65536;
+    static const char *kwlist[] = {"elem_size", "segment_size", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "n|n", (char**)kwlist, &elem_size, &segment_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (elem_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_size` must be >0");
+        return NULL;
+    }
+
+    if (segment_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`segment_size` must be >0");
+        return NULL;
+    }
+
+    HammingIndexObject *self = (HammingIndexObject*)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    trace.kernel_start(state->kernels.load(std::memory_order_acquire), (uint64_t)elem_size);
+    try {
+        self->index = new hexhamming_index((uint64_t)elem_size, (uint64_t)segment_size);
+    }
+    catch (const std::bad_alloc&) {
+        trace.kernel_end(-1);
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    trace.kernel_end(0);
+    return (PyObject*)self;
+}
+
+static void HammingIndex_dealloc(PyObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    delete ((HammingIndexObject*)self)->index;
+    type->tp_free(self);
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
+#endif
+}
+
+/**
+ * Appends packed records, shared by `append` and `extend`.
+ *
+ * @returns         id of first appended record, or NULL with exception set.
+ */
+static PyObject * HammingIndex_append_records(HammingIndexObject *self, PyObject *args, bool single) {
+    hexhamming_state *state = get_type_state(Py_TYPE(self));
+    trace_scope trace(state->latency, single ? ENTRY_HAMMING_INDEX_APPEND : ENTRY_HAMMING_INDEX_EXTEND);
+    uint8_t *records;
+    uint64_t records_size = 0;
+
+    if (!PyArg_ParseTuple(args, "s#", &records, &records_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    const uint64_t elem_size = self->index->get_elem_size();
+    if (single && records_size != elem_size) {
+        PyErr_SetString(PyExc_ValueError, "`elem` size must be equal to `elem_size`");
+        return NULL;
+    }
+
+    if (records_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_size`");
+        return NULL;
+    }
+
+    uint64_t first_id = 0;
+    bool failed = false;
+    trace.kernel_start(state->kernels.load(std::memory_order_acquire), elem_size);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        first_id = self->index->append(records, records_size / elem_size);
+    }
+    catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(failed ? -1 : (int64_t)first_id);
+    if (failed)
+        return PyErr_NoMemory();
+    return Py_BuildValue("K", first_id);
+}
+
+static PyObject * HammingIndex_append(PyObject *self, PyObject *args) {
+    return HammingIndex_append_records((HammingIndexObject*)self, args, true);
+}
+
+static PyObject * HammingIndex_extend(PyObject *self, PyObject *args) {
+    return HammingIndex_append_records((HammingIndexObject*)self, args, false);
+}
+
+static PyObject * HammingIndex_remove(PyObject *self, PyObject *args) {
+    hexhamming_state *state = get_type_state(Py_TYPE(self));
+    trace_scope trace(state->latency, ENTRY_HAMMING_INDEX_REMOVE);
+    unsigned long long id;
+
+    if (!PyArg_ParseTuple(args, "K", &id)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    hexhamming_index *index = ((HammingIndexObject*)self)->index;
+    trace.kernel_start(state->kernels.load(std::memory_order_acquire), index->get_elem_size());
+    const bool removed = index->remove(id);
+    trace.kernel_end(removed);
+    return PyBool_FromLong(removed);
+}
+
+static PyObject * HammingIndex_search(PyObject *self, PyObject *args, PyObject *kwds) {
+    trace_scope trace(get_type_state(Py_TYPE(self))->latency, ENTRY_HAMMING_INDEX_SEARCH);
+    uint8_t *small_array;
+    uint64_t small_array_size = 0;
+    int64_t max_dist;
+    int parallel = 0;
+    static const char *kwlist[] = {"elem_to_compare", "max_dist", "parallel", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s#L|p", (char**)kwlist, &small_array, &small_array_size,
+                                     &max_dist, &parallel)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    hexhamming_index *index = ((HammingIndexObject*)self)->index;
+    if (small_array_size != index->get_elem_size()) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be equal to `elem_size`");
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_type_state(Py_TYPE(self))->kernels.load(std::memory_order_acquire);
+    int64_t id;
+    trace.kernel_start(kernels, small_array_size);
+    Py_BEGIN_ALLOW_THREADS
+    if (parallel)
+        id = index->search_parallel(small_array, max_dist, kernels);
+    else
+        id = index->search(small_array, max_dist, kernels);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(id);
+    return Py_BuildValue("L", (long long)id);
+}
+
+static PyObject * HammingIndex_compact(PyObject *self, PyObject *unused) {
+    hexhamming_state *state = get_type_state(Py_TYPE(self));
+    trace_scope trace(state->latency, ENTRY_HAMMING_INDEX_COMPACT);
+    hexhamming_index *index = ((HammingIndexObject*)self)->index;
+    bool failed = false;
+    trace.kernel_start(state->kernels.load(std::memory_order_acquire), index->get_elem_size());
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        index->compact();
+    }
+    catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(failed ? -1 : (int64_t)index->size());
+    if (failed)
+        return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static Py_ssize_t HammingIndex_len(PyObject *self) {
+    return (Py_ssize_t)((HammingIndexObject*)self)->index->size();
+}
+
+static PyObject * HammingIndex_get_elem_size(PyObject *self, void *closure) {
+    return Py_BuildValue("K", ((HammingIndexObject*)self)->index->get_elem_size());
+}
+
+///////////////////////////////////////////////////////////////
+// Shared memory index
+///////////////////////////////////////////////////////////////
+
+/**
+ * Python interface for `publish_shared_index`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `publish_shared_index` interface
+ *                  - `name` - name of shared memory segment
+ *                  - `array_of_elems` - bytes
+ *                  - `elem_size` - size of one element in bytes
+ * @returns         None
+ */
+static PyObject * publish_shared_index_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_PUBLISH_SHARED_INDEX);
+    char *name;
+    uint8_t *big_array;
+    uint64_t big_array_size = 0;
+    Py_ssize_t elem_size;
+
+    if (!PyArg_ParseTuple(args, "ss#n", &name, &big_array, &big_array_size, &elem_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (elem_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_size` must be >0");
+        return NULL;
+    }
+
+    if (big_array_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_size`");
+        return NULL;
+    }
+
+    int error;
+    trace.kernel_start(get_kernels(self), (uint64_t)elem_size);
+    Py_BEGIN_ALLOW_THREADS
+    error = shared_index_publish(name, big_array, big_array_size / elem_size, elem_size);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(error != 0 ? -1 : (int64_t)(big_array_size / elem_size));
+    if (error != 0) {
+        errno = error;
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * Python interface for `unlink_shared_index`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `unlink_shared_index` interface
+ *                  - `name` - name of shared memory segment
+ * @returns         None
+ */
+static PyObject * unlink_shared_index_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_UNLINK_SHARED_INDEX);
+    char *name;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    trace.kernel_start(get_kernels(self), 0);
+    int error = shared_index_unlink(name);
+    trace.kernel_end(error != 0 ? -1 : 0);
+    if (error != 0) {
+        errno = error;
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+    }
+    Py_RETURN_NONE;
+}
+
+typedef struct {
+    PyObject_HEAD
+    const uint8_t *mapping;
+    uint64_t mapping_size;
+} SharedIndexObject;
+
+static inline const hexhamming_shared_header* SharedIndex_header(PyObject *self) {
+    return (const hexhamming_shared_header*)((SharedIndexObject*)self)->mapping;
+}
+
+static inline const uint8_t* SharedIndex_records(PyObject *self) {
+    return ((SharedIndexObject*)self)->mapping + SharedIndex_header(self)->data_offset;
+}
+
+static PyObject * SharedIndex_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    hexhamming_state *state = get_type_state(type);
+    trace_scope trace(state->latency, ENTRY_SHARED_INDEX_NEW);
+    char *name;
+    static const char *kwlist[] = {"name", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s", (char**)kwlist, &name)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    const uint8_t *mapping = NULL;
+    uint64_t mapping_size = 0;
+    trace.kernel_start(state->kernels.load(std::memory_order_acquire), 0);
+    int error = shared_index_attach(name, &mapping, &mapping_size);
+    trace.kernel_end(error != 0 ? -1 : (int64_t)((const hexhamming_shared_header*)mapping)->number_of_elements);
+    if (error != 0) {
+        errno = error;
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+    }
+
+    SharedIndexObject *self = (SharedIndexObject*)type->tp_alloc(type, 0);
+    if (self == NULL) {
+        shared_index_detach(mapping, mapping_size);
+        return NULL;
+    }
+    self->mapping = mapping;
+    self->mapping_size = mapping_size;
+    return (PyObject*)self;
+}
+
+static void SharedIndex_dealloc(PyObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    shared_index_detach(((SharedIndexObject*)self)->mapping, ((SharedIndexObject*)self)->mapping_size);
+    type->tp_free(self);
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
+#endif
+}
+
+static PyObject * SharedIndex_search(PyObject *self, PyObject *args) {
+    trace_scope trace(get_type_state(Py_TYPE(self))->latency, ENTRY_SHARED_INDEX_SEARCH);
+    uint8_t *small_array;
+    uint64_t small_array_size = 0;
+    int64_t max_dist;
+
+    if (!PyArg_ParseTuple(args, "s#L", &small_array, &small_array_size, &max_dist)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    const hexhamming_shared_header *header = SharedIndex_header(self);
+    if (small_array_size != header->elem_size) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be equal to `elem_size`");
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_type_state(Py_TYPE(self))->kernels.load(std::memory_order_acquire);
+    const uint8_t *records = SharedIndex_records(self);
+    int64_t index;
+    trace.kernel_start(kernels, small_array_size);
+    Py_BEGIN_ALLOW_THREADS
+    index = find_within_dist(kernels, records, header->number_of_elements, small_array, small_array_size, max_dist);
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(index);
+    return Py_BuildValue("L", (long long)index);
+}
+
+static Py_ssize_t SharedIndex_len(PyObject *self) {
+    return (Py_ssize_t)SharedIndex_header(self)->number_of_elements;
+}
+
+static PyObject * SharedIndex_get_elem_size(PyObject *self, void *closure) {
+    return Py_BuildValue("K", SharedIndex_header(self)->elem_size);
+}
+
+/**
+ * Exposes packed records read-only without copying. There is no release callback, so the object
+ * is accepted by `check_bytes_arrays_within_dist` and the other functions taking bytes.
+ */
+static int SharedIndex_getbuffer(PyObject *self, Py_buffer *view, int flags) {
+    const hexhamming_shared_header *header = SharedIndex_header(self);
+    return PyBuffer_FillInfo(view, self, (void*)SharedIndex_records(self),
+                             (Py_ssize_t)(header->number_of_elements * header->elem_size), 1, flags);
+}
+
+typedef struct {
+    PyObject_HEAD
+    hexhamming_popcount_index *index;
+} PopcountIndexObject;
+
+static PyObject * PopcountIndex_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    trace_scope trace(get_type_state(type)->latency, ENTRY_POPCOUNT_INDEX_NEW);
+    uint8_t *big_array;
+    uint64_t big_array_size = 0;
+    Py_ssize_t elem_size;
+    static const char *kwlist[] = {"array_of_elems", "elem_size", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s#n", (char**)kwlist, &big_array, &big_array_size, &elem_size)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    if (elem_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "`elem_size` must be >0");
+        return NULL;
+    }
+
+    if (big_array_size % elem_size != 0) {
+        PyErr_SetString(PyExc_ValueError, "`array_of_elems` size must be multiplier of `elem_size`");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_type_state(type)->kernels.load(std::memory_order_acquire);
+    hexhamming_popcount_index *index = NULL;
+    trace.kernel_start(kernels, (uint64_t)elem_size);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        index = new hexhamming_popcount_index(big_array, big_array_size / elem_size, (uint64_t)elem_size, kernels);
+    }
+    catch (const std::bad_alloc&) {
+        index = NULL;
+    }
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(index == NULL ? -1 : (int64_t)(big_array_size / elem_size));
+    if (index == NULL)
+        return PyErr_NoMemory();
+
+    PopcountIndexObject *self = (PopcountIndexObject*)type->tp_alloc(type, 0);
+    if (self == NULL) {
+        delete index;
+        return NULL;
+    }
+    self->index = index;
+    return (PyObject*)self;
+}
+
+static void PopcountIndex_dealloc(PyObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    delete ((PopcountIndexObject*)self)->index;
+    type->tp_free(self);
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
+#endif
+}
+
+static PyObject * PopcountIndex_within(PyObject *self, PyObject *args) {
+    trace_scope trace(get_type_state(Py_TYPE(self))->latency, ENTRY_POPCOUNT_INDEX_WITHIN);
+    uint8_t *small_array;
+    uint64_t small_array_size = 0;
+    int64_t max_dist;
+
+    if (!PyArg_ParseTuple(args, "s#L", &small_array, &small_array_size, &max_dist)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    const hexhamming_popcount_index *index = ((PopcountIndexObject*)self)->index;
+    if (small_array_size != index->get_elem_size()) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be equal to `elem_size`");
+        return NULL;
+    }
+
+    if (max_dist < 0) {
+        PyErr_SetString(PyExc_ValueError, "`max_dist` must be >=0");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_type_state(Py_TYPE(self))->kernels.load(std::memory_order_acquire);
+    std::vector<uint64_t> found;
+    bool failed = false;
+    trace.kernel_start(kernels, small_array_size);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        index->within(small_array, max_dist, kernels, found);
+    }
+    catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(failed || found.empty() ? -1 : (int64_t)found[0]);
+    if (failed)
+        return PyErr_NoMemory();
+
+    PyObject *result = PyList_New((Py_ssize_t)found.size());
+    if (result == NULL)
+        return NULL;
+    for (size_t i = 0; i < found.size(); i++) {
+        PyObject *position = PyLong_FromUnsignedLongLong(found[i]);
+        if (position == NULL) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        PyList_SET_ITEM(result, (Py_ssize_t)i, position);
+    }
+    return result;
+}
+
+static PyObject * PopcountIndex_nearest(PyObject *self, PyObject *args) {
+    trace_scope trace(get_type_state(Py_TYPE(self))->latency, ENTRY_POPCOUNT_INDEX_NEAREST);
+    uint8_t *small_array;
+    uint64_t small_array_size = 0;
+    Py_ssize_t k;
+
+    if (!PyArg_ParseTuple(args, "s#n", &small_array, &small_array_size, &k)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    const hexhamming_popcount_index *index = ((PopcountIndexObject*)self)->index;
+    if (small_array_size != index->get_elem_size()) {
+        PyErr_SetString(PyExc_ValueError, "`elem_to_compare` size must be equal to `elem_size`");
+        return NULL;
+    }
+
+    if (k < 0) {
+        PyErr_SetString(PyExc_ValueError, "`k` must be >=0");
+        return NULL;
+    }
+
+    const hexhamming_kernels* kernels = get_type_state(Py_TYPE(self))->kernels.load(std::memory_order_acquire);
+    std::vector<std::pair<uint64_t, uint64_t>> nearest;
+    bool failed = false;
+    trace.kernel_start(kernels, small_array_size);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        nearest.reserve(std::min((uint64_t)k, index->size()));
+        index->nearest(small_array, (uint64_t)k, kernels, nearest);
+    }
+    catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    trace.kernel_end(failed || nearest.empty() ? -1 : (int64_t)nearest[0].second);
+    if (failed)
+        return PyErr_NoMemory();
+
+    PyObject *result = PyList_New((Py_ssize_t)nearest.size());
+    if (result == NULL)
+        return NULL;
+    for (size_t i = 0; i < nearest.size(); i++) {
+        PyObject *match = Py_BuildValue("(KK)", nearest[i].second, nearest[i].first);
+        if (match == NULL) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        PyList_SET_ITEM(result, (Py_ssize_t)i, match);
+    }
+    return result;
+}
+
+static Py_ssize_t PopcountIndex_len(PyObject *self) {
+    return (Py_ssize_t)((PopcountIndexObject*)self)->index->size();
+}
+
+static PyObject * PopcountIndex_get_elem_size(PyObject *self, void *closure) {
+    return Py_BuildValue("K", ((PopcountIndexObject*)self)->index->get_elem_size());
+}
+
+/**
+ * Python interface for `set_algo`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `set_algo` interface
+ *                  - `string` -- string with one of those: "extra","native","sse41","classic"
+ * @returns         empty string if success or string with error.
+ */
+static PyObject * set_algo_wrapper(PyObject *self, PyObject *args) {
+    trace_scope trace(get_latency(self), ENTRY_SET_ALGO);
+    char *algo_name;
+
+    // get the one string with algo name. if they are incorrect types (i.e., not 's'), this will raise a ValueError
+    if (!PyArg_ParseTuple(args, "s", &algo_name)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    // if either c-string is NULL, can't move on, so raise
+    if (algo_name == NULL) {
+        PyErr_SetString(PyExc_ValueError, "no string provided!");
+        return NULL;
+    }
+
+    hexhamming_state *state = get_state(self);
+    const hexhamming_kernels *kernels = NULL;
+    const char *result = "";
+    trace.kernel_start(state->kernels.load(std::memory_order_acquire), 0);
+    const std::optional<hexhamming::algorithm> algorithm = hexhamming::parse_algorithm(algo_name);
+    if (!algorithm || hexhamming::algorithm_kernels(*algorithm) == NULL)
+        result = "Library was built without this algorithm.";
+    else if (!hexhamming::algorithm_supported(*algorithm, state->cpu_capabilities))
+        result = state->cpu_not_support_msg;
+    else
+        kernels = hexhamming::algorithm_kernels(*algorithm);
+    if (kernels != NULL)
+        state->kernels.store(kernels, std::memory_order_release);
+    trace.kernel_end(kernels == NULL ? -1 : kernels->id);
+    return Py_BuildValue("s", result);
+}
+
+/**
+ * Python interface for `set_latency_histograms`
+ *
+ * @param self      Python `self` object
+ * @param args      Python arguments for `set_latency_histograms` interface
+ *                  - `enabled` - bool, enabling clears histograms recorded so far
+ * @returns         None
+ */
+static PyObject * set_latency_histograms_wrapper(PyObject *self, PyObject *args) {
+    int enabled;
+
+    if (!PyArg_ParseTuple(args, "p", &enabled)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "error occurred while parsing arguments"
+        );
+        return NULL;
+    }
+
+    get_latency(self)->enable(enabled != 0);
+    Py_RETURN_NONE;
+}
+
+/**
+ * Python interface for `get_latency_histograms`
+ *
+ * @param self      Python `self` object
+ * @returns         dict mapping names of called entry points to lists of LATENCY_BUCKETS counts.
+ */
+static PyObject * get_latency_histograms_wrapper(PyObject *self, PyObject *unused) {
+    const hexhamming_latency *latency = get_latency(self);
+    PyObject *result = PyDict_New();
+    if (result == NULL)
+        return NULL;
+    for (int entry = 0; entry < ENTRY_POINTS; entry++) {
+        uint64_t counts[LATENCY_BUCKETS];
+        uint64_t calls = 0;
+        for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+            calls += counts[bucket] = latency->count((entry_point)entry, bucket);
+        if (calls == 0)
+            continue;
+        PyObject *histogram = PyList_New(LATENCY_BUCKETS);
+        if (histogram == NULL) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            PyObject *count = PyLong_FromUnsignedLongLong(counts[bucket]);
+            if (count == NULL) {
+                Py_DECREF(histogram);
+                Py_DECREF(result);
+                return NULL;
+            }
+            PyList_SET_ITEM(histogram, bucket, count);
+        }
+        const int added = PyDict_SetItemString(result, ENTRY_POINT_NAMES[entry], histogram);
+        Py_DECREF(histogram);
+        if (added < 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+    }
+    return result;
+}
+
+///////////////////////////////////////////////////////////////
+// Docstrings
+///////////////////////////////////////////////////////////////
+static char hamming_string_docstring[] =
+    "Calculate the hamming distance of two strings\n\n"
+    "This is equivalent to\n\n"
+    "    bin(int(a, 16) ^ int(b, 16)).count('1')\n\n"
+    "with the only difference being it was written in C and optimized\n"
+    "using a lookup table of pre-calculated hexadecimal hamming distances.\n"
+    ":param a: hexadecimal string\n"
+    ":type a: str\n"
+    ":param b: hexadecimal string\n"
+    ":type b: str\n"
+    ":returns: the hamming distance between the bits of two hexadecimal strings\n"
+    ":rtype: int\n"
+    ":raises ValueError: if either string doesn't exist, "
+    "if the strings are different lengths, or if the strings aren't valid hex";
+
+
+static char hamming_distance_pairs_docstring[] =
+    "Calculate hamming distances of pairs `seq_a[i]`, `seq_b[i]` of hex strings or byte strings.\n\n"
+    "Pairs are read without Python calls and computed with the GIL released. A pair that cannot be compared\n"
+    "(invalid hex, different lengths, mixed or other types) gets -1 instead of raising for the whole batch.\n"
+    ":param seq_a: sequence of str (hex) or bytes\n"
+    ":type seq_a: list\n"
+    ":param seq_b: sequence of str (hex) or bytes, same length as `seq_a`\n"
+    ":type seq_b: list\n"
+    ":returns: distance of every pair or -1\n"
+    ":rtype: array.array('q')\n"
+    ":raises ValueError: if the sequences are invalid or have different lengths.";
+
+static char hamming_byte_docstring[] =
     "Calculate the hamming distance of two byte strings\n\n"
     "with the only difference being it was written in C and optimized\n"
     "using a lookup table of pre-calculated hexadecimal hamming distances.\n"
@@ -406,12 +2561,433 @@ static char check_bytes_arrays_within_dist_docstring[] =
     ":rtype: int\n"
     ":raises ValueError: if input parameters are invalid.";
 
+static char and_or_count_bytes_docstring[] =
+    "Calculate intersection and union bit counts of two byte strings in one pass\n\n"
+    "This is equivalent to\n\n"
+    "    (bin(a & b).count('1'), bin(a | b).count('1'))\n\n"
+    ":param a: byte string\n"
+    ":type a: bytes\n"
+    ":param b: byte string\n"
+    ":type b: bytes\n"
+    ":returns: tuple of popcount(a & b) and popcount(a | b)\n"
+    ":rtype: tuple\n"
+    ":raises ValueError: if the byte strings are different lengths";
+
+static char tanimoto_bytes_docstring[] =
+    "Calculate Tanimoto (Jaccard) similarity of two byte strings\n\n"
+    "This is equivalent to popcount(a & b) / popcount(a | b);\n"
+    "two all-zero byte strings have similarity 1.0.\n"
+    ":param a: byte string\n"
+    ":type a: bytes\n"
+    ":param b: byte string\n"
+    ":type b: bytes\n"
+    ":returns: Tanimoto similarity between 0.0 and 1.0\n"
+    ":rtype: float\n"
+    ":raises ValueError: if the byte strings are different lengths";
+
+static char tanimoto_bytes_arrays_docstring[] =
+    "Calculate Tanimoto similarity of `elem_to_compare` to every element of byte array.\n\n"
+    "Size of `array_of_elems` must be multiplier of `elem_to_compare` size. \n\n"
+    ":param array_of_elems: array of bytes to search within\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_to_compare: will compare to each element in array_of_elems\n"
+    ":type elem_to_compare: bytes\n"
+    ":returns: list of similarities, one for each element in array_of_elems\n"
+    ":rtype: list\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char check_bytes_arrays_within_tanimoto_docstring[] =
+    "Check if any element of byte array has at least specified Tanimoto similarity\n"
+    "and return it's index or -1 otherwise.\n\n"
+    "Size of `array_of_elems` must be multiplier of `elem_to_compare` size. \n\n"
+    ":param array_of_elems: array of bytes to search within\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_to_compare: will compare to each element in array_of_elems\n"
+    ":type elem_to_compare: bytes\n"
+    ":param min_similarity: minimal Tanimoto similarity, between 0.0 and 1.0\n"
+    ":type min_similarity: float\n"
+    ":returns: index of first element in array_of_elems for which similarity >= `min_similarity` or -1. \n"
+    ":rtype: int\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char bitslice_bytes_array_docstring[] =
+    "Convert byte array of equal sized elements into bit-sliced layout for `check_bitsliced_within_dist`.\n\n"
+    "Elements are grouped in blocks of 256, bit `j` of all elements of a block is stored in 32 consecutive\n"
+    "bytes, so distances of a whole block are computed at once. Best suited for short hashes.\n"
+    ":param array_of_elems: array of bytes, same layout as in `check_bytes_arrays_within_dist`\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_size: size of one element in bytes\n"
+    ":type elem_size: int\n"
+    ":returns: elements in bit-sliced layout\n"
+    ":rtype: bytes\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char variance_permutation_docstring[] =
+    "Order byte positions of elements by how likely they are to differ between two elements.\n\n"
+    "A position is ranked by the expected number of its bits that differ, 2 * p * (1 - p) summed over its\n"
+    "bits, where p is the frequency of the bit in up to `sample_size` evenly spaced elements. Storing the\n"
+    "database and queries through `permute_bytes_array` with this order leaves distances unchanged and\n"
+    "lets threshold searches reject elements after fewer bytes.\n"
+    ":param array_of_elems: array of bytes, same layout as in `check_bytes_arrays_within_dist`\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_size: size of one element in bytes\n"
+    ":type elem_size: int\n"
+    ":param sample_size: maximum number of elements measured, defaults to 4096\n"
+    ":type sample_size: int\n"
+    ":returns: byte positions, most discriminative first, ties by position\n"
+    ":rtype: list[int]\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char permute_bytes_array_docstring[] =
+    "Reorder bytes of every element: byte `k` of an output element is byte `permutation[k]` of the input one.\n\n"
+    ":param array_of_elems: array of bytes, one or more elements of `len(permutation)` bytes\n"
+    ":type array_of_elems: bytes\n"
+    ":param permutation: every byte position of an element once, e.g. from `variance_permutation`\n"
+    ":type permutation: list[int]\n"
+    ":returns: permuted elements\n"
+    ":rtype: bytes\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char check_bitsliced_within_dist_docstring[] =
+    "Check if any element of bit-sliced array are within a specified Hamming Distance\n"
+    "and return it's index or -1 otherwise.\n\n"
+    ":param bitsliced_array: array returned by `bitslice_bytes_array`\n"
+    ":type bitsliced_array: bytes\n"
+    ":param number_of_elems: number of elements in bitsliced_array\n"
+    ":type number_of_elems: int\n"
+    ":param elem_to_compare: will compare to each element in bitsliced_array\n"
+    ":type elem_to_compare: bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":returns: index of first element in bitsliced_array for which hamming distance <= `max_dist` or -1. \n"
+    ":rtype: int\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char distance_histogram_docstring[] =
+    "Calculate distribution of Hamming distances from query(s) to every element of byte array.\n\n"
+    "`elem_to_compare` may hold several queries of `elem_size` bytes each, their histograms are summed.\n"
+    ":param array_of_elems: array of bytes to search within\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_to_compare: one or more queries\n"
+    ":type elem_to_compare: bytes\n"
+    ":param elem_size: size of one element, defaults to size of `elem_to_compare`\n"
+    ":type elem_size: int\n"
+    ":returns: list of `elem_size * 8 + 1` counts, item `d` is number of pairs at distance `d`\n"
+    ":rtype: list\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char count_within_dist_docstring[] =
+    "Count elements of byte array within a specified Hamming Distance of query(s).\n\n"
+    "`elem_to_compare` may hold several queries of `elem_size` bytes each, their counts are summed.\n"
+    ":param array_of_elems: array of bytes to search within\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_to_compare: one or more queries\n"
+    ":type elem_to_compare: bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":param elem_size: size of one element, defaults to size of `elem_to_compare`\n"
+    ":type elem_size: int\n"
+    ":returns: number of pairs with hamming distance <= `max_dist`\n"
+    ":rtype: int\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char hamming_rerank_docstring[] =
+    "Shortlist elements by Hamming distance of binary codes, then re-rank them by their float32 vectors.\n\n"
+    "Stage one keeps the `candidates` codes closest to `elem_to_compare` (0 for no limit), only those within\n"
+    "`max_dist` if it is not -1. Stage two scores vectors of the survivors against `query_vector`. The GIL\n"
+    "is released for both stages.\n"
+    ":param array_of_elems: binary codes, same layout as in `check_bytes_arrays_within_dist`\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_to_compare: binary code of the query\n"
+    ":type elem_to_compare: bytes\n"
+    ":param vectors: float32 vectors of the elements, in the same order, e.g. a C contiguous numpy array\n"
+    ":type vectors: buffer\n"
+    ":param query_vector: float32 vector of the query\n"
+    ":type query_vector: buffer\n"
+    ":param k: maximum number of results\n"
+    ":type k: int\n"
+    ":param candidates: size of the Hamming shortlist, defaults to 0 (no limit)\n"
+    ":type candidates: int\n"
+    ":param max_dist: Hamming radius of the shortlist, defaults to -1 (no limit)\n"
+    ":type max_dist: int\n"
+    ":param metric: \"dot\" (highest dot product first) or \"l2\" (lowest squared L2 distance first)\n"
+    ":type metric: str\n"
+    ":returns: (index, score) of up to `k` elements, best first, ties by index\n"
+    ":rtype: list[tuple[int, float]]\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char check_bytes_offsets_within_dist_docstring[] =
+    "Search records of different lengths, stored back to back, for each of several queries.\n\n"
+    "Records use the Arrow binary layout: record `i` is `data[offsets[i]:offsets[i + 1]]`.\n"
+    "Every query is compared only with records of its own length.\n"
+    ":param data: concatenated records\n"
+    ":type data: bytes\n"
+    ":param offsets: `number of records + 1` offsets into `data`, e.g. `array('i')` or `array('q')`\n"
+    ":type offsets: buffer of int32 or int64\n"
+    ":param elems_to_compare: queries, of any lengths\n"
+    ":type elems_to_compare: sequence of bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":returns: for every query, index of the first record of the same length with hamming distance\n"
+    "          <= `max_dist`, or -1\n"
+    ":rtype: list\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char sliding_hamming_docstring[] =
+    "Find `pattern` at every offset of `stream` within a specified Hamming Distance.\n\n"
+    "With `bit_granularity` the pattern is also tried at every bit offset, bits are numbered from\n"
+    "the most significant bit of the first byte.\n"
+    ":param stream: bytes to search in\n"
+    ":type stream: bytes\n"
+    ":param pattern: bytes to search for\n"
+    ":type pattern: bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":param bit_granularity: report bit offsets instead of byte offsets\n"
+    ":type bit_granularity: bool\n"
+    ":returns: (offset, distance) for every offset with hamming distance <= `max_dist`, ordered by offset\n"
+    ":rtype: list\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char submit_bytes_arrays_within_dist_docstring[] =
+    "Asynchronous `check_bytes_arrays_within_dist`, the search runs on native worker threads.\n\n"
+    "Returns `concurrent.futures.Future`, use `asyncio.wrap_future` to await it from asyncio.\n"
+    "Requests queued against the same `array_of_elems` object are answered with one pass over it.\n"
+    ":param array_of_elems: array of bytes to search within\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_to_compare: will compare to each element in array_of_elems\n"
+    ":type elem_to_compare: bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":returns: future with index of first element in array_of_elems for which hamming distance <= `max_dist` or -1. \n"
+    ":rtype: concurrent.futures.Future\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char HammingIndex_docstring[] =
+    "Mutable index of equally sized byte records for Hamming distance search.\n\n"
+    "Records are stored in aligned append-only segments of `segment_size` records, deletes only\n"
+    "mark records in a tombstone bitmap until `compact` merges the segments. All methods may be\n"
+    "called from different threads at the same time, searches keep running during updates.\n"
+    "Segments of 2 MB or more use huge pages and are spread over NUMA nodes.\n"
+    ":param elem_size: size of one record in bytes\n"
+    ":type elem_size: int\n"
+    ":param segment_size: number of records in one segment\n"
+    ":type segment_size: int\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char HammingIndex_append_docstring[] =
+    "Append one record and return its id. Ids are assigned in increasing order.\n\n"
+    ":param elem: record of `elem_size` bytes\n"
+    ":type elem: bytes\n"
+    ":returns: id of the record\n"
+    ":rtype: int";
+
+static char HammingIndex_extend_docstring[] =
+    "Append packed records and return id of the first one, next records get consecutive ids.\n\n"
+    ":param array_of_elems: records of `elem_size` bytes each\n"
+    ":type array_of_elems: bytes\n"
+    ":returns: id of the first record\n"
+    ":rtype: int";
+
+static char HammingIndex_remove_docstring[] =
+    "Delete record with id.\n\n"
+    ":param id: id returned by `append` or `extend`\n"
+    ":type id: int\n"
+    ":returns: False if there is no such record\n"
+    ":rtype: bool";
+
+static char HammingIndex_search_docstring[] =
+    "Return id of the first record within a specified Hamming Distance or -1.\n\n"
+    ":param elem_to_compare: will compare to each record in the index\n"
+    ":type elem_to_compare: bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":param parallel: scan segments on all worker threads, each on the NUMA node holding the segment\n"
+    ":type parallel: bool\n"
+    ":returns: smallest id of a record with hamming distance <= `max_dist` or -1\n"
+    ":rtype: int";
+
+static char HammingIndex_compact_docstring[] =
+    "Merge segments and drop deleted records. Releases the GIL, so it may run in a background thread\n"
+    "while other threads keep appending, deleting and searching.";
+
+static PyMethodDef HammingIndex_methods[] = {
+    {"append", HammingIndex_append, METH_VARARGS, HammingIndex_append_docstring},
+    {"extend", HammingIndex_extend, METH_VARARGS, HammingIndex_extend_docstring},
+    {"remove", HammingIndex_remove, METH_VARARGS, HammingIndex_remove_docstring},
+    {"search", (PyCFunction)(void(*)(void))HammingIndex_search, METH_VARARGS | METH_KEYWORDS,
+     HammingIndex_search_docstring},
+    {"compact", HammingIndex_compact, METH_NOARGS, HammingIndex_compact_docstring},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef HammingIndex_getset[] = {
+    {(char*)"elem_size", HammingIndex_get_elem_size, NULL, (char*)"size of one record in bytes", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot HammingIndex_slots[] = {
+    {Py_tp_new, (void*)HammingIndex_new},
+    {Py_tp_dealloc, (void*)HammingIndex_dealloc},
+    {Py_tp_doc, (void*)HammingIndex_docstring},
+    {Py_tp_methods, HammingIndex_methods},
+    {Py_tp_getset, HammingIndex_getset},
+    {Py_sq_length, (void*)HammingIndex_len},
+    {0, NULL}
+};
+
+static PyType_Spec HammingIndex_spec = {
+    "hexhamming.HammingIndex",
+    sizeof(HammingIndexObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    HammingIndex_slots
+};
+
+static char publish_shared_index_docstring[] =
+    "Copy packed byte array into a new named POSIX shared memory segment.\n\n"
+    "Other processes attach to it with `SharedIndex(name)` without copying or parsing the data.\n"
+    ":param name: name of shared memory segment, must not exist yet\n"
+    ":type name: str\n"
+    ":param array_of_elems: array of bytes, same layout as in `check_bytes_arrays_within_dist`\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_size: size of one element in bytes\n"
+    ":type elem_size: int\n"
+    ":raises ValueError: if input parameters are invalid.\n"
+    ":raises OSError: if the segment cannot be created.";
+
+static char unlink_shared_index_docstring[] =
+    "Remove named shared memory segment. Processes already attached keep their mapping.\n\n"
+    ":param name: name of shared memory segment\n"
+    ":type name: str\n"
+    ":raises OSError: if the segment cannot be removed.";
+
+static char SharedIndex_docstring[] =
+    "Read-only index attached to a shared memory segment created by `publish_shared_index`.\n\n"
+    "Supports the buffer protocol, so it can be passed as `array_of_elems` to\n"
+    "`check_bytes_arrays_within_dist` and similar functions.\n"
+    ":param name: name of shared memory segment\n"
+    ":type name: str\n"
+    ":raises OSError: if the segment does not exist or is not a complete index.";
+
+static char SharedIndex_search_docstring[] =
+    "Return index of the first element within a specified Hamming Distance or -1.\n\n"
+    ":param elem_to_compare: will compare to each element in the index\n"
+    ":type elem_to_compare: bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":returns: index of first element for which hamming distance <= `max_dist` or -1\n"
+    ":rtype: int";
+
+static PyMethodDef SharedIndex_methods[] = {
+    {"search", SharedIndex_search, METH_VARARGS, SharedIndex_search_docstring},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef SharedIndex_getset[] = {
+    {(char*)"elem_size", SharedIndex_get_elem_size, NULL, (char*)"size of one element in bytes", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot SharedIndex_slots[] = {
+    {Py_tp_new, (void*)SharedIndex_new},
+    {Py_tp_dealloc, (void*)SharedIndex_dealloc},
+    {Py_tp_doc, (void*)SharedIndex_docstring},
+    {Py_tp_methods, SharedIndex_methods},
+    {Py_tp_getset, SharedIndex_getset},
+    {Py_sq_length, (void*)SharedIndex_len},
+#if defined(Py_bf_getbuffer)
+    {Py_bf_getbuffer, (void*)SharedIndex_getbuffer},
+#endif
+    {0, NULL}
+};
+
+static PyType_Spec SharedIndex_spec = {
+    "hexhamming.SharedIndex",
+    sizeof(SharedIndexObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    SharedIndex_slots
+};
+
+static char PopcountIndex_docstring[] =
+    "Read-only copy of packed byte records grouped by their popcount.\n\n"
+    "The difference of popcounts is a lower bound of the Hamming distance, so searches skip whole\n"
+    "groups of records which cannot be close enough to the query. Works best for skewed sets of hashes.\n"
+    ":param array_of_elems: array of bytes, same layout as in `check_bytes_arrays_within_dist`\n"
+    ":type array_of_elems: bytes\n"
+    ":param elem_size: size of one element in bytes\n"
+    ":type elem_size: int\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char PopcountIndex_within_docstring[] =
+    "Return indices of all elements within a specified Hamming Distance.\n\n"
+    ":param elem_to_compare: will compare to each element in the index\n"
+    ":type elem_to_compare: bytes\n"
+    ":param max_dist: maximum allowable Hamming Distance\n"
+    ":type max_dist: int\n"
+    ":returns: indices (in `array_of_elems`) of elements with hamming distance <= `max_dist`, ascending\n"
+    ":rtype: list";
+
+static char PopcountIndex_nearest_docstring[] =
+    "Return the `k` elements closest to `elem_to_compare`.\n\n"
+    ":param elem_to_compare: will compare to each element in the index\n"
+    ":type elem_to_compare: bytes\n"
+    ":param k: number of elements to return\n"
+    ":type k: int\n"
+    ":returns: (index, distance) tuples ordered by distance, equal distances by index\n"
+    ":rtype: list";
+
+static PyMethodDef PopcountIndex_methods[] = {
+    {"within", PopcountIndex_within, METH_VARARGS, PopcountIndex_within_docstring},
+    {"nearest", PopcountIndex_nearest, METH_VARARGS, PopcountIndex_nearest_docstring},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef PopcountIndex_getset[] = {
+    {(char*)"elem_size", PopcountIndex_get_elem_size, NULL, (char*)"size of one element in bytes", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot PopcountIndex_slots[] = {
+    {Py_tp_new, (void*)PopcountIndex_new},
+    {Py_tp_dealloc, (void*)PopcountIndex_dealloc},
+    {Py_tp_doc, (void*)PopcountIndex_docstring},
+    {Py_tp_methods, PopcountIndex_methods},
+    {Py_tp_getset, PopcountIndex_getset},
+    {Py_sq_length, (void*)PopcountIndex_len},
+    {0, NULL}
+};
+
+static PyType_Spec PopcountIndex_spec = {
+    "hexhamming.PopcountIndex",
+    sizeof(PopcountIndexObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    PopcountIndex_slots
+};
+
 static char set_algo_docstring[] =
     "Change algo used for calculations, return empty string if ok or string with error.\n\n"
     "For Internal and test/benchmark use.\n\n"
-    ":param string: extra|native|sse41|classic\n"
+    ":param string: avx512|extra|native|sse41|classic\n"
+    ":raises ValueError: if input parameters are invalid.";
+
+static char set_latency_histograms_docstring[] =
+    "Start or stop recording latency histograms of the module functions and index methods.\n\n"
+    "Histograms are off by default, enabling them clears everything recorded before.\n"
+    "Read them with `get_latency_histograms`.\n\n"
+    ":param enabled: bool\n"
     ":raises ValueError: if input parameters are invalid.";
 
+static char get_latency_histograms_docstring[] =
+    "Return latency histograms recorded since `set_latency_histograms(True)`.\n\n"
+    "Dict maps names of functions called at least once (\"HammingIndex.search\" for\n"
+    "methods, the type name for constructors) to lists of 40 counts: item `i` is the\n"
+    "number of calls that took [2**i, 2**(i + 1)) nanoseconds, the last item also\n"
+    "counts longer calls.\n\n"
+    ":return: dict of str to list of int";
+
 static char CompareDocstring[] =
     "Module for calculating hamming distance of two hexadecimal strings";
 
@@ -421,76 +2997,154 @@ static char CompareDocstring[] =
 static PyMethodDef CompareMethods[] = {
     {"hamming_distance_string", hamming_distance_string_wrapper, METH_VARARGS, hamming_string_docstring},
     {"hamming_distance_bytes", hamming_distance_byte_wrapper, METH_VARARGS, hamming_byte_docstring},
+    {"hamming_distance_pairs", hamming_distance_pairs_wrapper, METH_VARARGS, hamming_distance_pairs_docstring},
     {"check_hexstrings_within_dist", check_hexstrings_within_dist_wrapper, METH_VARARGS, check_hexstrings_within_dist_docstring},
     {"check_bytes_arrays_within_dist", check_bytes_arrays_within_dist_wrapper, METH_VARARGS, check_bytes_arrays_within_dist_docstring},
+    {"and_or_count_bytes", and_or_count_bytes_wrapper, METH_VARARGS, and_or_count_bytes_docstring},
+    {"tanimoto_bytes", tanimoto_bytes_wrapper, METH_VARARGS, tanimoto_bytes_docstring},
+    {"tanimoto_bytes_arrays", tanimoto_bytes_arrays_wrapper, METH_VARARGS, tanimoto_bytes_arrays_docstring},
+    {"check_bytes_arrays_within_tanimoto", check_bytes_arrays_within_tanimoto_wrapper, METH_VARARGS, check_bytes_arrays_within_tanimoto_docstring},
+    {"bitslice_bytes_array", bitslice_bytes_array_wrapper, METH_VARARGS, bitslice_bytes_array_docstring},
+    {"check_bitsliced_within_dist", check_bitsliced_within_dist_wrapper, METH_VARARGS, check_bitsliced_within_dist_docstring},
+    {"variance_permutation", variance_permutation_wrapper, METH_VARARGS, variance_permutation_docstring},
+    {"permute_bytes_array", permute_bytes_array_wrapper, METH_VARARGS, permute_bytes_array_docstring},
+    {"distance_histogram", distance_histogram_wrapper, METH_VARARGS, distance_histogram_docstring},
+    {"count_within_dist", count_within_dist_wrapper, METH_VARARGS, count_within_dist_docstring},
+    {"check_bytes_offsets_within_dist", check_bytes_offsets_within_dist_wrapper, METH_VARARGS,
+     check_bytes_offsets_within_dist_docstring},
+    {"sliding_hamming", (PyCFunction)(void(*)(void))sliding_hamming_wrapper, METH_VARARGS | METH_KEYWORDS,
+     sliding_hamming_docstring},
+    {"hamming_rerank", (PyCFunction)(void(*)(void))hamming_rerank_wrapper, METH_VARARGS | METH_KEYWORDS,
+     hamming_rerank_docstring},
+    {"submit_bytes_arrays_within_dist", submit_bytes_arrays_within_dist_wrapper, METH_VARARGS, submit_bytes_arrays_within_dist_docstring},
+    {"publish_shared_index", publish_shared_index_wrapper, METH_VARARGS, publish_shared_index_docstring},
+    {"unlink_shared_index", unlink_shared_index_wrapper, METH_VARARGS, unlink_shared_index_docstring},
     {"set_algo", set_algo_wrapper, METH_VARARGS, set_algo_docstring},
+    {"set_latency_histograms", set_latency_histograms_wrapper, METH_VARARGS, set_latency_histograms_docstring},
+    {"get_latency_histograms", get_latency_histograms_wrapper, METH_NOARGS, get_latency_histograms_docstring},
     {NULL, NULL, 0, NULL}
 };
 
-#if PY_MAJOR_VERSION >= 3
+/**
+ * Creates heap type bound to the module and adds it as module attribute.
+ */
+static int add_type(PyObject *module, PyType_Spec *spec, const char *name) {
+#if PY_VERSION_HEX >= 0x03090000
+    PyObject *type = PyType_FromModuleAndSpec(module, spec, NULL);
+#else
+    PyObject *type = PyType_FromSpec(spec);
+#endif
+    if (type == NULL)
+        return -1;
+    if (PyModule_AddObject(module, name, type) < 0) {
+        Py_DECREF(type);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Module exec slot: detects CPU and selects the fastest kernels for this module instance.
+ */
+static int hexhamming_exec(PyObject *module) {
+    hexhamming_state *state = get_state(module);
+    state->cpu_capabilities = hexhamming::cpu_capabilities();
+    new (&state->kernels) std::atomic<const hexhamming_kernels*>(best_kernels(state->cpu_capabilities));
+    snprintf(state->cpu_not_support_msg, sizeof(state->cpu_not_support_msg),
+             "CPU doesnt support this feature. {%X}", state->cpu_capabilities);
+    state->pending = new hexhamming_pending();
+    state->latency = new hexhamming_latency();
+    if (PyModule_AddStringConstant(module, "__version__", _version))
+        return -1;
+
+    PyObject *array_module = PyImport_ImportModule("array");
+    if (array_module == NULL)
+        return -1;
+    state->array_type = PyObject_GetAttrString(array_module, "array");
+    Py_DECREF(array_module);
+    if (state->array_type == NULL)
+        return -1;
+
+    PyObject *futures_module = PyImport_ImportModule("concurrent.futures");
+    if (futures_module == NULL)
+        return -1;
+    state->future_type = PyObject_GetAttrString(futures_module, "Future");
+    Py_DECREF(futures_module);
+    if (state->future_type == NULL)
+        return -1;
+
+#if PY_VERSION_HEX < 0x03090000
+    legacy_state = state;
+#endif
+    if (add_type(module, &HammingIndex_spec, "HammingIndex") < 0)
+        return -1;
+    if (add_type(module, &SharedIndex_spec, "SharedIndex") < 0)
+        return -1;
+    if (add_type(module, &PopcountIndex_spec, "PopcountIndex") < 0)
+        return -1;
+
+    // complete all asynchronous requests while the interpreter is still fully alive
+    PyObject *atexit = PyImport_ImportModule("atexit");
+    if (atexit == NULL)
+        return -1;
+    PyObject *wait_for_pending = PyCFunction_New(&wait_for_pending_def, module);
+    PyObject *registered = NULL;
+    if (wait_for_pending != NULL)
+        registered = PyObject_CallMethod(atexit, "register", "O", wait_for_pending);
+    Py_XDECREF(wait_for_pending);
+    Py_DECREF(atexit);
+    if (registered == NULL)
+        return -1;
+    Py_DECREF(registered);
+    return 0;
+}
+
+static int hexhamming_traverse(PyObject *module, visitproc visit, void *arg) {
+    Py_VISIT(get_state(module)->array_type);
+    Py_VISIT(get_state(module)->future_type);
+    return 0;
+}
+
+static int hexhamming_clear(PyObject *module) {
+    Py_CLEAR(get_state(module)->array_type);
+    Py_CLEAR(get_state(module)->future_type);
+    return 0;
+}
+
+static void hexhamming_free(void *module) {
+    hexhamming_state *state = get_state((PyObject*)module);
+    hexhamming_clear((PyObject*)module);
+    delete state->pending;
+    state->pending = NULL;
+    delete state->latency;
+    state->latency = NULL;
+}
+
+static PyModuleDef_Slot hexhamming_slots[] = {
+    {Py_mod_exec, (void*)hexhamming_exec},
+#if defined(Py_mod_multiple_interpreters)
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#if defined(Py_mod_gil)
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL}
+};
 
 static struct PyModuleDef hexhammingdef = {
         PyModuleDef_HEAD_INIT,
         "hexhamming",
         CompareDocstring,
-        -1,
+        sizeof(hexhamming_state),
         CompareMethods,
-        NULL
+        hexhamming_slots,
+        hexhamming_traverse,
+        hexhamming_clear,
+        hexhamming_free
 };
 
-#define INITERROR return NULL
-
 PyMODINIT_FUNC
 PyInit_hexhamming(void)
-
-#else
-#define INITERROR return
-
-PyMODINIT_FUNC
-inithexhamming(void)
-#endif
-
 {
-     #if defined(CPU_X86_64)
-        cpu_capabilities = get_cpuid();
-        if ((cpu_capabilities & bit_AVX2) == bit_AVX2) {
-            USE__EXTRA
-        }
-#if defined(HAVE_NATIVE_POPCNT)
-        else if ((cpu_capabilities & bit_POPCNT) == bit_POPCNT) {
-            USE__NATIVE
-        }
-#endif
-        else if ((cpu_capabilities & bit_SSE41) == bit_SSE41) {
-            USE__SSE41
-        }
-        else {
-            USE__CLASSIC
-        }
-     #else
-        #if defined(HAVE_NATIVE_POPCNT)
-            cpu_capabilities = bit_POPCNT;
-            USE__NATIVE
-        #else
-            USE__CLASSIC
-        #endif
-        USE__EXTRA
-     #endif
-     snprintf(cpu_not_support_msg, sizeof(cpu_not_support_msg), "CPU doesnt support this feature. {%X}", cpu_capabilities);
-#if PY_MAJOR_VERSION >= 3
-    PyObject *module = PyModule_Create(&hexhammingdef);
-#else
-    PyObject *module = Py_InitModule3("hexhamming", CompareMethods, CompareDocstring);
-#endif
-    if (PyModule_AddStringConstant(module, "__version__", _version)) {
-        Py_XDECREF(module);
-        INITERROR;
-    }
-    if (module == NULL) {
-        INITERROR;
-    }
-
-#if PY_MAJOR_VERSION >= 3
-    return module;
-#endif
+    return PyModuleDef_Init(&hexhammingdef);
 }
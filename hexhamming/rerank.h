@@ -0,0 +1,105 @@
+#ifndef HEXHAMMING_RERANK_H
+#define HEXHAMMING_RERANK_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "kernels.h"
+
+using hexhamming::detail::bytes_kernel_for_length;
+using hexhamming::detail::find_within_dist;
+using hexhamming::detail::hamming_distance_bytes_fn;
+using hexhamming::detail::hexhamming_kernels;
+using hexhamming::detail::VECTOR_DOT;
+using hexhamming::detail::vector_metric;
+using hexhamming::detail::vector_score_fn;
+
+/* Two-stage search of records stored twice, in the same order: as packed binary codes of `elem_size` bytes
+   and as float32 vectors of `dimensions` items. Codes shortlist candidates by Hamming distance, then the
+   vectors of the survivors are scored against the query vector, without leaving native code. */
+
+/**
+ * Stores to `shortlist` (distance, index) pairs of codes closest to `query`: at most `candidates` of them
+ * (0 for no limit), only those within `max_dist` if it is >= 0. Ordered by index.
+ */
+static void hamming_shortlist(const hexhamming_kernels *kernels, const uint8_t *codes,
+                              const uint64_t number_of_elements, const uint8_t *query, const uint64_t elem_size,
+                              const uint64_t candidates, const int64_t max_dist,
+                              std::vector<std::pair<uint64_t, uint64_t>> &shortlist) {
+    shortlist.clear();
+    const hamming_distance_bytes_fn distance = bytes_kernel_for_length(kernels, elem_size);
+    if (candidates == 0) {
+        for (uint64_t start = 0; start < number_of_elements;) {
+            int64_t hit = 0;
+            if (max_dist >= 0) {
+                hit = find_within_dist(kernels, codes + start * elem_size, number_of_elements - start, query,
+                                       elem_size, max_dist);
+                if (hit < 0)
+                    break;
+            }
+            const uint64_t index = start + (uint64_t)hit;
+            shortlist.emplace_back(distance(codes + index * elem_size, query, elem_size, -1), index);
+            start = index + 1;
+        }
+        return;
+    }
+    // max heap on (distance, index), its front is the worst of the best `candidates`
+    for (uint64_t i = 0; i < number_of_elements; i++) {
+        const uint8_t *code = codes + i * elem_size;
+        const int64_t limit = shortlist.size() == candidates ? (int64_t)shortlist.front().first : max_dist;
+        if (limit >= 0 && distance(code, query, elem_size, limit) == 0)
+            continue;
+        const std::pair<uint64_t, uint64_t> candidate(distance(code, query, elem_size, -1), i);
+        if (shortlist.size() == candidates) {
+            if (!(candidate < shortlist.front()))
+                continue;
+            std::pop_heap(shortlist.begin(), shortlist.end());
+            shortlist.pop_back();
+        }
+        shortlist.push_back(candidate);
+        std::push_heap(shortlist.begin(), shortlist.end());
+    }
+    std::sort(shortlist.begin(), shortlist.end(),
+              [](const std::pair<uint64_t, uint64_t> &x, const std::pair<uint64_t, uint64_t> &y) {
+                  return x.second < y.second;
+              });
+}
+
+/**
+ * Stores to `ranked` up to `k` (score, index) pairs of the shortlist from `hamming_shortlist`, best first:
+ * highest dot product or lowest squared L2 distance of their vectors to `query_vector`, ties by index.
+ * Vectors scoring NaN come last.
+ */
+static void rerank_shortlist(const hexhamming_kernels *kernels,
+                             const std::vector<std::pair<uint64_t, uint64_t>> &shortlist, const float *vectors,
+                             const float *query_vector, const uint64_t dimensions, const vector_metric metric,
+                             const uint64_t k, std::vector<std::pair<float, uint64_t>> &ranked) {
+    const vector_score_fn score = kernels->vector_score[metric];
+    ranked.clear();
+    ranked.reserve(shortlist.size());
+    for (const std::pair<uint64_t, uint64_t> &candidate : shortlist) {
+        const float *vector = vectors + candidate.second * dimensions;
+        const float value = score(vector, query_vector, dimensions);
+        // ordered ascending, dot products are negated so the best comes first either way
+        ranked.emplace_back(metric == VECTOR_DOT ? -value : value, candidate.second);
+    }
+    const uint64_t best = std::min<uint64_t>(k, ranked.size());
+    // NaN compares false to everything, it has to be ordered explicitly to keep the comparison a strict order
+    std::partial_sort(ranked.begin(), ranked.begin() + best, ranked.end(),
+                      [](const std::pair<float, uint64_t> &x, const std::pair<float, uint64_t> &y) {
+                          const bool x_nan = std::isnan(x.first), y_nan = std::isnan(y.first);
+                          if (x_nan != y_nan)
+                              return y_nan;
+                          if (!x_nan && x.first != y.first)
+                              return x.first < y.first;
+                          return x.second < y.second;
+                      });
+    ranked.resize(best);
+    if (metric == VECTOR_DOT)
+        for (std::pair<float, uint64_t> &item : ranked)
+            item.first = -item.first;
+}
+
+#endif  //HEXHAMMING_RERANK_H
@@ -0,0 +1,142 @@
+#ifndef HEXHAMMING_SHARED_MEMORY_H
+#define HEXHAMMING_SHARED_MEMORY_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#if !defined(_WIN32)
+    #define HAVE_SHARED_MEMORY
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "kernels.h"
+
+/* Shared index layout: header at the start of the segment, packed records (same layout as in
+   `check_bytes_arrays_within_dist`) at `data_offset`, which keeps them 64 bytes aligned. */
+#define SHARED_INDEX_MAGIC       "HEXHIDX1"
+#define SHARED_INDEX_DATA_OFFSET 64
+
+struct hexhamming_shared_header {
+    char magic[8];
+    uint64_t elem_size;
+    uint64_t number_of_elements;
+    uint64_t data_offset;
+};
+
+// POSIX shared memory names start with exactly one slash.
+static inline std::string shared_index_name(const char *name) {
+    return name[0] == '/' ? std::string(name) : "/" + std::string(name);
+}
+
+#if defined(HAVE_SHARED_MEMORY)
+    /**
+     * Creates named shared memory segment and copies packed records into it.
+     * The magic is written last, so processes attaching meanwhile see an incomplete index as invalid.
+     *
+     * @return      0 on success or errno value
+     */
+    static int shared_index_publish(const char *name, const uint8_t *array, const uint64_t number_of_elements,
+                                    const uint64_t elem_size) {
+        const std::string shm_name = shared_index_name(name);
+        const uint64_t size = SHARED_INDEX_DATA_OFFSET + number_of_elements * elem_size;
+        int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+            return errno;
+        if (ftruncate(fd, (off_t)size) != 0) {
+            int error = errno;
+            close(fd);
+            shm_unlink(shm_name.c_str());
+            return error;
+        }
+        uint8_t *memory = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (memory == MAP_FAILED) {
+            shm_unlink(shm_name.c_str());
+            return error;
+        }
+        hexhamming_shared_header *header = (hexhamming_shared_header*)memory;
+        header->elem_size = elem_size;
+        header->number_of_elements = number_of_elements;
+        header->data_offset = SHARED_INDEX_DATA_OFFSET;
+        memcpy(memory + SHARED_INDEX_DATA_OFFSET, array, number_of_elements * elem_size);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(header->magic, SHARED_INDEX_MAGIC, sizeof(header->magic));
+        munmap(memory, size);
+        return 0;
+    }
+
+    /**
+     * Maps named shared index read-only. Nothing is copied, records are used right from the mapping.
+     *
+     * @param mapping     receives start of mapping (header)
+     * @param mapping_size receives size of mapping
+     * @return      0 on success, errno value, or EINVAL if the segment is not a complete index
+     */
+    static int shared_index_attach(const char *name, const uint8_t **mapping, uint64_t *mapping_size) {
+        const std::string shm_name = shared_index_name(name);
+        int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return errno;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error = errno;
+            close(fd);
+            return error;
+        }
+        const uint64_t size = (uint64_t)info.st_size;
+        if (size < SHARED_INDEX_DATA_OFFSET) {
+            close(fd);
+            return EINVAL;
+        }
+        void *memory = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (memory == MAP_FAILED)
+            return error;
+        const hexhamming_shared_header *header = (const hexhamming_shared_header*)memory;
+        if (memcmp(header->magic, SHARED_INDEX_MAGIC, sizeof(header->magic)) != 0 || header->elem_size == 0 ||
+            header->data_offset != SHARED_INDEX_DATA_OFFSET ||
+            (size - SHARED_INDEX_DATA_OFFSET) / header->elem_size < header->number_of_elements) {
+            munmap(memory, size);
+            return EINVAL;
+        }
+        *mapping = (const uint8_t*)memory;
+        *mapping_size = size;
+        return 0;
+    }
+
+    static void shared_index_detach(const uint8_t *mapping, const uint64_t mapping_size) {
+        munmap((void*)mapping, mapping_size);
+    }
+
+    // @return      0 on success or errno value
+    static int shared_index_unlink(const char *name) {
+        if (shm_unlink(shared_index_name(name).c_str()) != 0)
+            return errno;
+        return 0;
+    }
+#else
+    static int shared_index_publish(const char *name, const uint8_t *array, const uint64_t number_of_elements,
+                                    const uint64_t elem_size) {
+        return ENOSYS;
+    }
+
+    static int shared_index_attach(const char *name, const uint8_t **mapping, uint64_t *mapping_size) {
+        return ENOSYS;
+    }
+
+    static void shared_index_detach(const uint8_t *mapping, const uint64_t mapping_size) {
+    }
+
+    static int shared_index_unlink(const char *name) {
+        return ENOSYS;
+    }
+#endif
+
+#endif  //HEXHAMMING_SHARED_MEMORY_H
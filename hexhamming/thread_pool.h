@@ -0,0 +1,106 @@
+#ifndef HEXHAMMING_THREAD_POOL_H
+#define HEXHAMMING_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "numa.h"
+
+/**
+ * Process wide pool of native worker threads. Workers never touch Python objects by themselves,
+ * tasks which need the interpreter must attach a thread state on their own.
+ *
+ * The pool is created on first use and intentionally never destroyed: idle workers are blocked
+ * on a condition variable and simply vanish together with the process.
+ *
+ * On machines with several NUMA nodes every node gets one worker per CPU, pinned to the CPUs of
+ * that node. Tasks submitted to a node run only on its workers, other tasks run anywhere.
+ */
+class hexhamming_thread_pool {
+public:
+    static hexhamming_thread_pool& instance() {
+        static hexhamming_thread_pool* pool = new hexhamming_thread_pool();
+        return *pool;
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        task_ready.notify_one();
+    }
+
+    // Runs `task` on a worker of NUMA node `node`.
+    void submit_to_node(const size_t node, std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            node_tasks[node].push_back(std::move(task));
+        }
+        // workers of all nodes wait on the same condition variable
+        task_ready.notify_all();
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    size_t nodes() const {
+        return node_workers.size();
+    }
+
+    size_t workers_on_node(const size_t node) const {
+        return node_workers[node];
+    }
+
+private:
+    hexhamming_thread_pool() {
+        const hexhamming_numa_topology topology = numa_topology();
+        if (topology.size() > 1) {
+            node_tasks.resize(topology.size());
+            for (size_t node = 0; node < topology.size(); node++) {
+                node_workers.push_back(topology[node].size());
+                for (size_t i = 0; i < topology[node].size(); i++)
+                    workers.emplace_back(&hexhamming_thread_pool::worker_loop, this, node, topology[node]);
+            }
+            return;
+        }
+        unsigned int count = std::thread::hardware_concurrency();
+        if (count == 0)
+            count = 1;
+        node_tasks.resize(1);
+        node_workers.push_back(count);
+        for (unsigned int i = 0; i < count; i++)
+            workers.emplace_back(&hexhamming_thread_pool::worker_loop, this, 0, std::vector<int>());
+    }
+
+    void worker_loop(const size_t node, const std::vector<int> cpus) {
+        if (!cpus.empty())
+            pin_current_thread(cpus);
+        std::deque<std::function<void()>> &own_tasks = node_tasks[node];
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_ready.wait(lock, [this, &own_tasks] { return !own_tasks.empty() || !tasks.empty(); });
+                std::deque<std::function<void()>> &queue = own_tasks.empty() ? tasks : own_tasks;
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::deque<std::function<void()>>> node_tasks;
+    std::vector<size_t> node_workers;
+    std::vector<std::thread> workers;
+};
+
+#endif  //HEXHAMMING_THREAD_POOL_H
@@ -0,0 +1,208 @@
+#ifndef HEXHAMMING_TRACE_H
+#define HEXHAMMING_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "kernels.h"
+
+using hexhamming::detail::hexhamming_kernels;
+
+/* Static (USDT) probes of provider `hexhamming`. With <sys/sdt.h> every probe is a single nop until a
+   tracer attaches to it, without it they compile to nothing. Every instrumented entry point fires:
+     entry(name)                             when the call starts
+     kernel_start(name, kernel_id, length)   before its kernels run, `length` is the record (or input) size
+     kernel_end(name, result)                after them, `result` is the match index, count or distance
+     exit(name)                              before it returns, also on errors
+   Asynchronous calls fire kernel_start and kernel_end from the pool task running their scan. Index
+   maintenance calls fire them around their work, `result` is the first id, removed flag or record count.
+   Calls without a record size to report (set_algo, shared memory attach and unlink) pass `length` 0; the
+   `result` of set_algo is the selected `kernels_id`, of unlink 0, of SharedIndex its record count, all -1
+   on failure.
+   `name` is the Python name of the entry point, `kernel_id` the `kernels_id` of the selected algorithm, e.g.
+     bpftrace -e 'usdt:./hexhamming*.so:hexhamming:kernel_end { @[str(arg0)] = lhist(arg1, -1, 100, 1); }' */
+#if defined(__has_include)
+    #if __has_include(<sys/sdt.h>)
+        #include <sys/sdt.h>
+        #define HAVE_USDT_PROBES
+    #endif
+#endif
+#if defined(HAVE_USDT_PROBES)
+    #define HEXHAMMING_PROBE1(probe, a) DTRACE_PROBE1(hexhamming, probe, a)
+    #define HEXHAMMING_PROBE2(probe, a, b) DTRACE_PROBE2(hexhamming, probe, a, b)
+    #define HEXHAMMING_PROBE3(probe, a, b, c) DTRACE_PROBE3(hexhamming, probe, a, b, c)
+#else
+    #define HEXHAMMING_PROBE1(probe, a) ((void)(a))
+    #define HEXHAMMING_PROBE2(probe, a, b) ((void)(a), (void)(b))
+    #define HEXHAMMING_PROBE3(probe, a, b, c) ((void)(a), (void)(b), (void)(c))
+#endif
+
+// Instrumented entry points, names in ENTRY_POINT_NAMES.
+enum entry_point {
+    ENTRY_HAMMING_DISTANCE_STRING,
+    ENTRY_HAMMING_DISTANCE_BYTES,
+    ENTRY_HAMMING_DISTANCE_PAIRS,
+    ENTRY_CHECK_HEXSTRINGS_WITHIN_DIST,
+    ENTRY_CHECK_BYTES_ARRAYS_WITHIN_DIST,
+    ENTRY_SUBMIT_BYTES_ARRAYS_WITHIN_DIST,
+    ENTRY_AND_OR_COUNT_BYTES,
+    ENTRY_TANIMOTO_BYTES,
+    ENTRY_TANIMOTO_BYTES_ARRAYS,
+    ENTRY_CHECK_BYTES_ARRAYS_WITHIN_TANIMOTO,
+    ENTRY_BITSLICE_BYTES_ARRAY,
+    ENTRY_CHECK_BITSLICED_WITHIN_DIST,
+    ENTRY_VARIANCE_PERMUTATION,
+    ENTRY_PERMUTE_BYTES_ARRAY,
+    ENTRY_DISTANCE_HISTOGRAM,
+    ENTRY_COUNT_WITHIN_DIST,
+    ENTRY_CHECK_BYTES_OFFSETS_WITHIN_DIST,
+    ENTRY_SLIDING_HAMMING,
+    ENTRY_HAMMING_RERANK,
+    ENTRY_SET_ALGO,
+    ENTRY_HAMMING_INDEX_NEW,
+    ENTRY_HAMMING_INDEX_APPEND,
+    ENTRY_HAMMING_INDEX_EXTEND,
+    ENTRY_HAMMING_INDEX_REMOVE,
+    ENTRY_HAMMING_INDEX_SEARCH,
+    ENTRY_HAMMING_INDEX_COMPACT,
+    ENTRY_PUBLISH_SHARED_INDEX,
+    ENTRY_UNLINK_SHARED_INDEX,
+    ENTRY_SHARED_INDEX_NEW,
+    ENTRY_SHARED_INDEX_SEARCH,
+    ENTRY_POPCOUNT_INDEX_NEW,
+    ENTRY_POPCOUNT_INDEX_WITHIN,
+    ENTRY_POPCOUNT_INDEX_NEAREST,
+    ENTRY_POINTS
+};
+
+static const char *const ENTRY_POINT_NAMES[ENTRY_POINTS] = {
+    "hamming_distance_string",
+    "hamming_distance_bytes",
+    "hamming_distance_pairs",
+    "check_hexstrings_within_dist",
+    "check_bytes_arrays_within_dist",
+    "submit_bytes_arrays_within_dist",
+    "and_or_count_bytes",
+    "tanimoto_bytes",
+    "tanimoto_bytes_arrays",
+    "check_bytes_arrays_within_tanimoto",
+    "bitslice_bytes_array",
+    "check_bitsliced_within_dist",
+    "variance_permutation",
+    "permute_bytes_array",
+    "distance_histogram",
+    "count_within_dist",
+    "check_bytes_offsets_within_dist",
+    "sliding_hamming",
+    "hamming_rerank",
+    "set_algo",
+    "HammingIndex",
+    "HammingIndex.append",
+    "HammingIndex.extend",
+    "HammingIndex.remove",
+    "HammingIndex.search",
+    "HammingIndex.compact",
+    "publish_shared_index",
+    "unlink_shared_index",
+    "SharedIndex",
+    "SharedIndex.search",
+    "PopcountIndex",
+    "PopcountIndex.within",
+    "PopcountIndex.nearest",
+};
+
+// Kernel probes of `entry`, also for kernels run outside of its `trace_scope` (pool tasks).
+static inline void trace_kernel_start(const entry_point entry, const hexhamming_kernels *kernels,
+                                      const uint64_t length) {
+    HEXHAMMING_PROBE3(kernel_start, ENTRY_POINT_NAMES[entry], kernels->id, length);
+}
+
+static inline void trace_kernel_end(const entry_point entry, const int64_t result) {
+    HEXHAMMING_PROBE2(kernel_end, ENTRY_POINT_NAMES[entry], result);
+}
+
+// Bucket `b` counts calls that took [2^b, 2^(b + 1)) ns, the last one everything longer.
+#define LATENCY_BUCKETS 40
+
+/**
+ * Optional log2 latency histogram of every entry point, off until enabled. Counters are relaxed atomics:
+ * calls from several threads are all counted, a snapshot taken meanwhile may miss the latest ones.
+ */
+class hexhamming_latency {
+public:
+    hexhamming_latency() : enabled(false) {
+        reset();
+    }
+
+    bool is_enabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Enabling starts from empty histograms.
+    void enable(const bool on) {
+        if (on)
+            reset();
+        enabled.store(on, std::memory_order_relaxed);
+    }
+
+    void record(const entry_point entry, uint64_t nanoseconds) {
+        int bucket = 0;
+        for (; nanoseconds > 1 && bucket < LATENCY_BUCKETS - 1; nanoseconds >>= 1)
+            bucket++;
+        buckets[entry][bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t count(const entry_point entry, const int bucket) const {
+        return buckets[entry][bucket].load(std::memory_order_relaxed);
+    }
+
+private:
+    void reset() {
+        for (int entry = 0; entry < ENTRY_POINTS; entry++)
+            for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+                buckets[entry][bucket].store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> enabled;
+    std::atomic<uint64_t> buckets[ENTRY_POINTS][LATENCY_BUCKETS];
+};
+
+/**
+ * Lives for one call of an entry point: fires its probes and, when histograms are enabled, records how
+ * long the call took, argument parsing and errors included.
+ */
+class trace_scope {
+public:
+    trace_scope(hexhamming_latency *latency, const entry_point entry)
+        : latency(latency->is_enabled() ? latency : nullptr), entry(entry) {
+        HEXHAMMING_PROBE1(entry, ENTRY_POINT_NAMES[entry]);
+        if (this->latency != nullptr)
+            start = std::chrono::steady_clock::now();
+    }
+
+    ~trace_scope() {
+        HEXHAMMING_PROBE1(exit, ENTRY_POINT_NAMES[entry]);
+        if (latency != nullptr)
+            latency->record(entry, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+    void kernel_start(const hexhamming_kernels *kernels, const uint64_t length) const {
+        trace_kernel_start(entry, kernels, length);
+    }
+
+    void kernel_end(const int64_t result) const {
+        trace_kernel_end(entry, result);
+    }
+
+private:
+    hexhamming_latency *const latency;
+    const entry_point entry;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif  //HEXHAMMING_TRACE_H
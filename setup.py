@@ -3,6 +3,7 @@ from setuptools import setup, Extension
 from platform import machine, system, uname
 from re import search, IGNORECASE
 from os import environ
+from glob import glob
 
 
 def get_version():
@@ -18,14 +19,22 @@ with open("requirements-dev.txt", "r", encoding="utf-8") as fh:
     test_requirements = [line.rstrip() for line in fh.readlines()]
 
 extra_compile_args = []
+libraries = []
 if system().lower() == "darwin" and (machine().lower() == "arm64" or
                                      environ.get("CIBW_ARCHS_MACOS", "") == "arm64"):
     extra_compile_args.append("-mcpu=apple-m1")
 elif uname().system == 'Windows':
+    extra_compile_args.append("/std:c++17")
     extra_compile_args.append("-O2")
     extra_compile_args.append("/d2FH4-")
-else:
+elif environ.get("HEXHAMMING_MARCH_NATIVE", "") == "1":
+    # x86 kernels carry their own target attributes and are dispatched at runtime,
+    # so wheels are built for the baseline ISA unless a local build asks otherwise
     extra_compile_args.append("-march=native")
+if uname().system != 'Windows':
+    extra_compile_args.append("-std=c++17")     # hexhamming.hpp
+if system().lower() == "linux":
+    libraries.append("rt")                  # shm_open, part of libc only since glibc 2.34
 
 setup(
     name="hexhamming",
@@ -40,8 +49,10 @@ setup(
         Extension(
             name="hexhamming",
             sources=["hexhamming/python_hexhamming.cc"],
+            depends=glob("hexhamming/*.h") + glob("hexhamming/*.hpp"),
             extra_compile_args=extra_compile_args,
-            language="c++11",
+            libraries=libraries,
+            language="c++",
         )
     ],
     author="Michael Recachinas",
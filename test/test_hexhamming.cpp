@@ -0,0 +1,123 @@
+// Checks of the C++ interface, run by ctest. Every algorithm the CPU supports is compared with classic.
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hexhamming/hexhamming.hpp"
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+// Defined in test_hexhamming_second_tu.cpp.
+const hexhamming::detail::hexhamming_kernels* second_tu_kernels(hexhamming::algorithm algorithm);
+const hexhamming::detail::hexhamming_kernels* second_tu_classic_table();
+
+template <typename Call>
+static bool throws_invalid_argument(Call call) {
+    try {
+        call();
+    }
+    catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+static void check_algorithm(const hexhamming::dispatcher &hamming) {
+    const hexhamming::dispatcher classic(hexhamming::algorithm::classic);
+    std::mt19937 random(40);
+    for (size_t length = 0; length < 200; length++) {
+        std::vector<uint8_t> a(length), b(length);
+        for (size_t i = 0; i < length; i++) {
+            a[i] = (uint8_t)random();
+            b[i] = (uint8_t)random();
+        }
+        const uint64_t expected = classic.distance(hexhamming::bytes_view(a), hexhamming::bytes_view(b));
+        CHECK(hamming.distance(hexhamming::bytes_view(a), hexhamming::bytes_view(b)) == expected);
+        CHECK(hamming.within(hexhamming::bytes_view(a), hexhamming::bytes_view(b), expected));
+        CHECK(expected == 0 || !hamming.within(hexhamming::bytes_view(a), hexhamming::bytes_view(b), expected - 1));
+        CHECK(hamming.and_or_count(hexhamming::bytes_view(a), hexhamming::bytes_view(b)) ==
+              classic.and_or_count(hexhamming::bytes_view(a), hexhamming::bytes_view(b)));
+    }
+
+    CHECK(hamming.distance(std::string_view("ffff"), std::string_view("fffe")) == 1);
+    CHECK(throws_invalid_argument([&] { hamming.distance(std::string_view("fg"), std::string_view("ff")); }));
+    CHECK(throws_invalid_argument([&] { hamming.distance(std::string_view("f"), std::string_view("ff")); }));
+
+    // 8 bytes records go through the batch kernels, 3 bytes ones through the generic kernel
+    std::vector<hexhamming::record<8>> hashes(100);
+    for (size_t i = 0; i < hashes.size(); i++)
+        hashes[i].fill(0xFF);
+    hashes[77].fill(0x00);
+    hashes[77][3] = 0x01;
+    const hexhamming::record<8> zero = {};
+    CHECK(hamming.find_within_dist(hexhamming::span<const hexhamming::record<8>>(hashes), zero, 1) == 77);
+    CHECK(hamming.find_within_dist(hexhamming::span<const hexhamming::record<8>>(hashes), zero, 0) == -1);
+    CHECK(hamming.distance(hashes[77], zero) == 1);
+    const hexhamming::bytes_view packed(hashes.data()->data(), hashes.size() * 8);
+    CHECK(hamming.find_within_dist(packed, hexhamming::bytes_view(zero), 1) == 77);
+    CHECK(hamming.count_within_dist(packed, hexhamming::bytes_view(zero), 64) == 100);
+
+    const std::vector<uint8_t> records = {0xFF, 0xFF, 0xFF, 0x00, 0x01, 0x00};
+    const std::vector<uint8_t> query = {0x00, 0x00, 0x00};
+    std::vector<uint64_t> distances(2);
+    hamming.distances(hexhamming::bytes_view(records), hexhamming::bytes_view(query), hexhamming::span<uint64_t>(distances));
+    CHECK(distances[0] == 24 && distances[1] == 1);
+    CHECK(throws_invalid_argument([&] {
+        hamming.find_within_dist(hexhamming::bytes_view(records), hexhamming::bytes_view(records.data(), 4), 1);
+    }));
+}
+
+static void check_permutation() {
+    // last byte varies, first one is constant: the permutation moves the last byte to the front
+    std::vector<uint8_t> records;
+    for (int r = 0; r < 64; r++)
+        records.insert(records.end(), {0xAA, (uint8_t)(r & 1), (uint8_t)r});
+    const std::vector<uint64_t> permutation = hexhamming::variance_permutation(records, 3);
+    CHECK((permutation == std::vector<uint64_t>{2, 1, 0}));
+    const std::vector<uint8_t> permuted = hexhamming::permute(records, permutation);
+    const std::vector<uint8_t> query = {0xAA, 1, 7};
+    const std::vector<uint8_t> permuted_query = hexhamming::permute(query, permutation);
+    CHECK(permuted[0] == 0 && permuted[1] == 0 && permuted[2] == 0xAA && permuted[3] == 1);
+    const hexhamming::dispatcher hamming;
+    for (uint64_t max_dist = 0; max_dist < 8; max_dist++)
+        CHECK(hamming.find_within_dist(records, query, max_dist) ==
+              hamming.find_within_dist(permuted, permuted_query, max_dist));
+    const std::vector<uint64_t> duplicate = {0, 0, 1};
+    CHECK(throws_invalid_argument([&] { hexhamming::permute(records, duplicate); }));
+    CHECK(throws_invalid_argument([&] { hexhamming::variance_permutation(records, 5); }));
+}
+
+static void check_one_definition() {
+    CHECK(second_tu_classic_table() == &hexhamming::detail::KERNELS__CLASSIC);
+    CHECK(second_tu_kernels(hexhamming::algorithm::classic) == &hexhamming::detail::KERNELS__CLASSIC);
+    CHECK(second_tu_kernels(hexhamming::algorithm::classic) ==
+          hexhamming::dispatcher(hexhamming::algorithm::classic).kernels());
+}
+
+int main() {
+    const hexhamming::algorithm algorithms[] = {
+        hexhamming::algorithm::avx512, hexhamming::algorithm::extra, hexhamming::algorithm::native,
+        hexhamming::algorithm::sse41, hexhamming::algorithm::classic
+    };
+    for (const hexhamming::algorithm algorithm : algorithms) {
+        if (hexhamming::algorithm_kernels(algorithm) == nullptr ||
+            !hexhamming::algorithm_supported(algorithm, hexhamming::cpu_capabilities()))
+            continue;
+        check_algorithm(hexhamming::dispatcher(algorithm));
+    }
+    check_algorithm(hexhamming::dispatcher());
+    check_permutation();
+    check_one_definition();
+    CHECK(hexhamming::parse_algorithm("extra") == hexhamming::algorithm::extra);
+    CHECK(!hexhamming::parse_algorithm("fastest"));
+    printf("hexhamming %s: ok\n", hexhamming::version);
+    return 0;
+}
@@ -1,8 +1,22 @@
 #!/usr/bin/env python
-from platform import machine
+from array import array
+from math import isnan
+from os import getpid
+from platform import machine, system
+from random import Random
+from subprocess import check_output
+from sys import executable
+from threading import Thread
+import asyncio
 import pytest
 from hexhamming import check_hexstrings_within_dist, hamming_distance_string, \
-                        hamming_distance_bytes, check_bytes_arrays_within_dist, set_algo
+                        hamming_distance_bytes, check_bytes_arrays_within_dist, set_algo, \
+                        and_or_count_bytes, tanimoto_bytes, tanimoto_bytes_arrays, \
+                        check_bytes_arrays_within_tanimoto, bitslice_bytes_array, check_bitsliced_within_dist, \
+                        distance_histogram, count_within_dist, submit_bytes_arrays_within_dist, \
+                        HammingIndex, SharedIndex, publish_shared_index, unlink_shared_index, sliding_hamming, \
+                        check_bytes_offsets_within_dist, PopcountIndex, variance_permutation, permute_bytes_array, \
+                        hamming_rerank, hamming_distance_pairs, set_latency_histograms, get_latency_histograms
 
 ############################
 # hamming_distance tests
@@ -68,7 +82,7 @@ def test_hamming_distance_string(hex1, hex2, expected):
 def test_hamming_distance_byte(hex1, hex2, expected):
     algorithm_list = ['extra', 'native', 'classic']
     if machine().lower().startswith('x86'):
-        algorithm_list.append('sse41')
+        algorithm_list += ['sse41', 'avx512']
     for algorithm in algorithm_list:
         result = set_algo(algorithm)
         if len(result) > 0:
@@ -77,6 +91,98 @@ def test_hamming_distance_byte(hex1, hex2, expected):
         assert expected == hamming_distance_bytes(hex1, hex2)
 
 
+def test_hamming_distance_bytes_tails():
+    # every SIMD width handles tails shorter than its register differently
+    rng = Random(37)
+    cases = []
+    for length in list(range(0, 130)) + [255, 256, 257, 1000]:
+        a = bytes(rng.getrandbits(8) for _ in range(length))
+        b = bytes(rng.getrandbits(8) for _ in range(length))
+        cases.append((a, b, sum(bin(x ^ y).count("1") for x, y in zip(a, b))))
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        for a, b, expected in cases:
+            assert expected == hamming_distance_bytes(a, b)
+            if a:
+                assert check_bytes_arrays_within_dist(a, b, expected) == 0
+                if expected > 0:
+                    assert check_bytes_arrays_within_dist(a, b, expected - 1) == -1
+
+
+def test_hamming_distance_pairs():
+    rng = Random(44)
+    seq_a, seq_b = [], []
+    for length in list(range(0, 40)) + [64, 100, 1000]:
+        seq_a.append("".join(rng.choice("0123456789abcdefABCDEF") for _ in range(length)))
+        seq_b.append("".join(rng.choice("0123456789abcdefABCDEF") for _ in range(length)))
+        seq_a.append(bytes(rng.getrandbits(8) for _ in range(length)))
+        seq_b.append(bytes(rng.getrandbits(8) for _ in range(length)))
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        distances = hamming_distance_pairs(seq_a, seq_b)
+        assert array("q") == distances[:0]
+        assert [hamming_distance_string(a, b) if isinstance(a, str) else hamming_distance_bytes(a, b)
+                for a, b in zip(seq_a, seq_b)] == list(distances)
+        assert distances == hamming_distance_pairs(tuple(seq_a), iter(seq_b))
+
+
+def test_hamming_distance_pairs_invalid_elements():
+    seq_a = ["ff", "0g", "abc", b"\x01", "\u00e9f", "ff", 3, "", b""]
+    seq_b = ["00", "00", "ab", b"\x03", "0f", b"\xff", 3, "", b""]
+    assert array("q", [8, -1, -1, 1, -1, -1, -1, 0, 0]) == hamming_distance_pairs(seq_a, seq_b)
+    assert array("q") == hamming_distance_pairs([], [])
+
+
+@pytest.mark.parametrize(
+    "seq_a,seq_b,msg",
+    (
+        (["00"], ["00", "11"], "`seq_a` and `seq_b` must be the same length"),
+        (3, ["00"], "`seq_a` must be a sequence of str or bytes"),
+        (["00"], None, "`seq_b` must be a sequence of str or bytes"),
+    ),
+)
+def test_hamming_distance_pairs_invalid_values(seq_a, seq_b, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = hamming_distance_pairs(seq_a, seq_b)
+    assert msg in str(excinfo.value)
+
+
+def test_check_bytes_arrays_within_dist_threshold_checks():
+    # threshold kernels compare with `max_dist` only every few blocks, differences packed at
+    # either end of a record must still be decided exactly
+    cases = []
+    for length in (16, 32, 64, 100, 256, 1000, 4096):
+        for different in (1, 8, length // 2, length):
+            ones = b"\xff" * different + b"\x00" * (length - different)
+            cases.append((ones, b"\x00" * length, different * 8))
+            cases.append((ones[::-1], b"\x00" * length, different * 8))
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        for a, b, distance in cases:
+            assert check_bytes_arrays_within_dist(a, b, distance) == 0
+            assert check_bytes_arrays_within_dist(a, b, distance - 1) == -1
+            assert check_bytes_arrays_within_dist(a + a, b, distance - 1) == -1
+            assert check_bytes_arrays_within_dist(a + b, b, distance - 1) == 1
+
+
 @pytest.mark.parametrize(
     "hex1,hex2,exception,msg",
     (
@@ -87,6 +193,10 @@ def test_hamming_distance_byte(hex1, hex2, expected):
         ("f" * 32, "f" * 31 + "g", ValueError, "hex string contains invalid char"),
         ("f" * 30, "f" * 29 + "g", ValueError, "hex string contains invalid char"),
         ("ggg", "ggg", ValueError, "hex string contains invalid char"),
+        ("abc\u00e9", "abcd", ValueError, "hex string contains invalid char"),
+        ("abcd", "ab\U0001F600d", ValueError, "hex string contains invalid char"),
+        ("ab\x00d", "abcd", ValueError, "hex string contains invalid char"),
+        (b"abcd", "abcd", ValueError, "error occurred while parsing arguments"),
         (
             "g" * 15 + "fff",
             "g" * 15 + "000",
@@ -112,7 +222,7 @@ def test_hamming_distance_string_errors(hex1, hex2, exception, msg):
 def test_check_hexstrings_within_dist(hex1, hex2, max_dist, expected):
     algorithm_list = ['extra', 'native', 'classic']
     if machine().lower().startswith('x86'):
-        algorithm_list.append('sse41')
+        algorithm_list += ['sse41', 'avx512']
     for algorithm in algorithm_list:
         result = set_algo(algorithm)
         if len(result) > 0:
@@ -141,6 +251,8 @@ def test_check_hexstrings_within_dist(hex1, hex2, max_dist, expected):
         ("000abcdef", "011abcdef", -1, ValueError, "`max_dist` must be >0"),
         ("000abcdef", "011abcdzz", 3, ValueError, "hex string contains invalid char"),
         ("000abcdef", "011abcdgf", 3, ValueError, "hex string contains invalid char"),
+        ("000abcd\u00e9", "011abcdef", 3, ValueError, "hex string contains invalid char"),
+        ("ggg", "ggg", 1, ValueError, "hex string contains invalid char"),
         ("1f0abcdef", 3, 3, ValueError, "error occurred while parsing arguments"),
         ("011abcdef", "00", 3, ValueError, "strings are NOT the same length"),
     ),
@@ -207,15 +319,925 @@ def test_check_bytes_arrays_within_dist_invalid_values(bytes1, bytes2, max_dist,
 def test_check_bytes_arrays_within_dist_calculation(bytes1, bytes2, max_dist, expected):
     algorithm_list = ['extra', 'native', 'classic']
     if machine().lower().startswith('x86'):
-        algorithm_list.append('sse41')
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        assert expected == check_bytes_arrays_within_dist(bytes1, bytes2, max_dist)
+
+
+@pytest.mark.parametrize("elem_size", (8, 16))
+def test_check_bytes_arrays_within_dist_short_records(elem_size):
+    # 8 and 16 bytes records are compared several per SIMD register; cover every lane and partial batches
+    rng = Random(38)
+    query = bytes(rng.getrandbits(8) for _ in range(elem_size))
+    cases = []
+    for number_of_elements in (1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 33, 100):
+        records = [bytes(rng.getrandbits(8) for _ in range(elem_size)) for _ in range(number_of_elements)]
+        for position in range(number_of_elements):
+            near = bytearray(query)
+            near[position % elem_size] ^= 0x01
+            near_records = records[:position] + [bytes(near)] + records[position + 1:]
+            distances = [sum(bin(x ^ y).count("1") for x, y in zip(r, query)) for r in near_records]
+            for max_dist in (0, 1, 2, elem_size * 2):
+                expected = next((i for i, d in enumerate(distances) if d <= max_dist), -1)
+                cases.append((b"".join(near_records), max_dist, expected))
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        for records, max_dist, expected in cases:
+            assert expected == check_bytes_arrays_within_dist(records, query, max_dist)
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,expected",
+    (
+        (b"", b"", (0, 0)),
+        (b"\x0F", b"\xFF", (4, 8)),
+        (b"\xF0" * 256, b"\x3C" * 256, (2 * 256, 6 * 256)),
+        (b"\xAA" * 255 + b"\x01", b"\xFF" * 255 + b"\x00", (4 * 255, 8 * 255 + 1)),
+        (b"\x00" * 77, b"\x00" * 77, (0, 0)),
+    ),
+    ids=(
+        "empty-empty",
+        "1-byte",
+        "2048-bit",
+        "odd-tail",
+        "77-zero",
+    ),
+)
+def test_and_or_count_bytes(bytes1, bytes2, expected):
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        assert expected == and_or_count_bytes(bytes1, bytes2)
+        assert expected == and_or_count_bytes(bytes2, bytes1)
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,expected",
+    (
+        (b"\x00" * 8, b"\x00" * 8, 1.0),
+        (b"\xFF" * 8, b"\x00" * 8, 0.0),
+        (b"\x0F", b"\xFF", 0.5),
+        (b"\xF0" * 256, b"\x3C" * 256, 2 / 6),
+    ),
+)
+def test_tanimoto_bytes(bytes1, bytes2, expected):
+    assert expected == pytest.approx(tanimoto_bytes(bytes1, bytes2))
+
+
+def test_tanimoto_bytes_arrays():
+    array = b"\xFF" * 256 + b"\x0F" * 256 + b"\x00" * 256
+    assert [1.0, 0.5, 0.0] == pytest.approx(tanimoto_bytes_arrays(array, b"\xFF" * 256))
+    assert [] == tanimoto_bytes_arrays(b"", b"\xFF")
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,min_similarity,expected",
+    (
+        (b"\x00" * 256 + b"\x0F" * 256 + b"\xFF" * 256, b"\xFF" * 256, 0.5, 1),
+        (b"\x00" * 256 + b"\x0F" * 256 + b"\xFF" * 256, b"\xFF" * 256, 0.51, 2),
+        (b"\x00" * 256 + b"\x0F" * 256, b"\xFF" * 256, 0.51, -1),
+        (b"\x00" * 256, b"\xFF" * 256, 0.0, 0),
+    ),
+)
+def test_check_bytes_arrays_within_tanimoto(bytes1, bytes2, min_similarity, expected):
+    assert expected == check_bytes_arrays_within_tanimoto(bytes1, bytes2, min_similarity)
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,min_similarity,msg",
+    (
+        (b"\x00" * 32, b"\x00" * 16, 1.5, "`min_similarity` must be within [0, 1]"),
+        (b"\x00" * 31, b"\x00" * 16, 0.5, "`array_of_elems` size must be multiplier of `elem_to_compare`"),
+        (b"\x00" * 32, b"", 0.5, "`elem_to_compare` size must be >0"),
+        (b"\x00" * 32, b"\x00" * 16, "HELLO", "error occurred while parsing arguments"),
+    ),
+)
+def test_check_bytes_arrays_within_tanimoto_invalid_values(bytes1, bytes2, min_similarity, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = check_bytes_arrays_within_tanimoto(bytes1, bytes2, min_similarity)
+    assert msg in str(excinfo.value)
+
+
+def test_bitslice_bytes_array():
+    assert b"" == bitslice_bytes_array(b"", 8)
+    sliced = bitslice_bytes_array(b"\x01\x00" + b"\x00\x80", 2)
+    assert 16 * 32 == len(sliced)
+    assert b"\x01" + b"\x00" * 31 == sliced[:32]
+    assert b"\x02" + b"\x00" * 31 == sliced[15 * 32:]
+    assert sliced.count(0) == len(sliced) - 2
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,max_dist,expected",
+    (
+        (b"\x00" * 8, b"\xFF" * 8, 50, -1),
+        (b"\x00" * 8, b"\x00" * 7 + b"\x0F", 4, 0),
+        (b"\xFF" * 8 * 300 + b"\x0F" * 8, b"\x00" * 2 + b"\x0F" * 6, 8, 300),
+        (b"\xFF" * 8 * 700 + b"\x0F" * 8, b"\x00" * 2 + b"\x0F" * 6, 7, -1),
+        (b"\xF0" * 64 + b"\x0A" * 64, b"\x0F" * 64, 3 * 64, 1),
+        (b"\xF0" * 3 * 5, b"\x0F" * 3, 24, 0),
+        (b"\xF0" * 3 * 5, b"\x0F" * 3, 23, -1),
+        (b"", b"\x0F" * 8, 64, -1),
+    ),
+)
+def test_check_bitsliced_within_dist(bytes1, bytes2, max_dist, expected):
+    sliced = bitslice_bytes_array(bytes1, len(bytes2))
+    count = len(bytes1) // len(bytes2)
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
     for algorithm in algorithm_list:
         result = set_algo(algorithm)
         if len(result) > 0:
             print(f'Warning: Skipping {algorithm}, reason: {result}')
             continue
+        assert expected == check_bitsliced_within_dist(sliced, count, bytes2, max_dist)
         assert expected == check_bytes_arrays_within_dist(bytes1, bytes2, max_dist)
 
 
+@pytest.mark.parametrize(
+    "count,bytes2,max_dist,msg",
+    (
+        (1, b"\x00" * 8, -1, "`max_dist` must be >=0"),
+        (1, b"", 3, "`elem_to_compare` size must be >0"),
+        (257, b"\x00" * 8, 3, "`bitsliced_array` size does not match"),
+        (-1, b"\x00" * 8, 3, "`bitsliced_array` size does not match"),
+        (2 ** 61, b"\x5a" * 8, 0, "`bitsliced_array` size does not match"),
+    ),
+)
+def test_check_bitsliced_within_dist_invalid_values(count, bytes2, max_dist, msg):
+    sliced = bitslice_bytes_array(b"\x00" * 8, 8)
+    with pytest.raises(ValueError) as excinfo:
+        _ = check_bitsliced_within_dist(sliced, count, bytes2, max_dist)
+    assert msg in str(excinfo.value)
+
+
+def test_check_bitsliced_within_dist_size_overflow():
+    # the size of 2**61 elements of 8 bytes wraps around to 0 in 64 bits
+    for query in (b"\x5a" * 8, b"\x00" * 8):
+        with pytest.raises(ValueError) as excinfo:
+            _ = check_bitsliced_within_dist(b"", 2 ** 61, query, 0)
+        assert "`bitsliced_array` size does not match" in str(excinfo.value)
+
+
+def hash_like_records(count, elem_size, seed):
+    # leading bytes almost constant, trailing bytes random, like perceptual hashes
+    rng = Random(seed)
+    return b"".join(bytes(rng.getrandbits(1) if i < elem_size // 2 else rng.getrandbits(8)
+                          for i in range(elem_size)) for _ in range(count))
+
+
+def test_variance_permutation():
+    assert [0] == variance_permutation(b"", 1)
+    records = b"".join(bytes([0xAA, r & 1, r]) for r in range(64))
+    assert [2, 1, 0] == variance_permutation(records, 3)
+    # 8 evenly spaced samples are all even
+    assert [2, 0, 1] == variance_permutation(records, 3, 8)
+    # ties keep positions in order
+    assert [0, 1, 2] == variance_permutation(b"\x0F" * 30, 3)
+    permutation = variance_permutation(hash_like_records(512, 32, 42), 32)
+    assert sorted(permutation[:16]) == list(range(16, 32))
+
+
+def test_permute_bytes_array():
+    assert b"" == permute_bytes_array(b"", [1, 0])
+    assert b"\x03\x01\x02\x06\x04\x05" == permute_bytes_array(b"\x01\x02\x03\x04\x05\x06", (2, 0, 1))
+    records = hash_like_records(300, 32, 43)
+    queries = hash_like_records(8, 32, 44)
+    permutation = variance_permutation(records, 32)
+    permuted = permute_bytes_array(records, permutation)
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        for q in range(0, len(queries), 32):
+            query = queries[q:q + 32]
+            permuted_query = permute_bytes_array(query, permutation)
+            assert hamming_distance_bytes(query, records[:32]) == hamming_distance_bytes(permuted_query, permuted[:32])
+            for max_dist in (0, 40, 60, 80, 256):
+                assert check_bytes_arrays_within_dist(records, query, max_dist) == \
+                    check_bytes_arrays_within_dist(permuted, permuted_query, max_dist)
+
+
+@pytest.mark.parametrize(
+    "array,elem_size,sample_size,msg",
+    (
+        (b"\x00" * 8, 0, 10, "`elem_size` must be >0"),
+        (b"\x00" * 8, 3, 10, "`array_of_elems` size must be multiplier of `elem_size`"),
+        (b"\x00" * 8, 16, 10, "`array_of_elems` size must be multiplier of `elem_size`"),
+        (b"\x00" * 8, 8, 0, "`sample_size` must be >0"),
+    ),
+)
+def test_variance_permutation_invalid_values(array, elem_size, sample_size, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = variance_permutation(array, elem_size, sample_size)
+    assert msg in str(excinfo.value)
+
+
+def test_variance_permutation_too_large():
+    with pytest.raises(MemoryError):
+        _ = variance_permutation(b"", 1 << 61)
+
+
+@pytest.mark.parametrize(
+    "array,permutation,msg",
+    (
+        (b"\x00" * 8, [], "`permutation` must not be empty"),
+        (b"\x00" * 8, [0, 0], "`permutation` must hold every position of an element once"),
+        (b"\x00" * 8, [0, 2], "`permutation` must hold every position of an element once"),
+        (b"\x00" * 8, [0, -1], "`permutation` must be a sequence of int"),
+        (b"\x00" * 8, [0, "1"], "`permutation` must be a sequence of int"),
+        (b"\x00" * 8, 3, "`permutation` must be a sequence of int"),
+        (b"\x00" * 8, [2, 0, 1], "`array_of_elems` size must be multiplier of `permutation` size"),
+    ),
+)
+def test_permute_bytes_array_invalid_values(array, permutation, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = permute_bytes_array(array, permutation)
+    assert msg in str(excinfo.value)
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,elem_size,expected",
+    (
+        (b"\x00\x01\x03\x07", b"\x00", 0, [1, 1, 1, 1, 0, 0, 0, 0, 0]),
+        (b"\x00\x01\x03\x07", b"\x00\x07", 1, [2, 2, 2, 2, 0, 0, 0, 0, 0]),
+        (b"\xFF" * 40 + b"\x00" * 40, b"\xFF" * 40, 0, [1] + [0] * 319 + [1]),
+        (b"", b"\x00" * 2, 0, [0] * 17),
+    ),
+    ids=(
+        "single-query",
+        "multi-query",
+        "320-bit",
+        "empty",
+    ),
+)
+def test_distance_histogram(bytes1, bytes2, elem_size, expected):
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        if elem_size:
+            assert expected == distance_histogram(bytes1, bytes2, elem_size)
+        else:
+            assert expected == distance_histogram(bytes1, bytes2)
+        for max_dist in range(len(expected)):
+            expected_count = sum(expected[:max_dist + 1])
+            if elem_size:
+                assert expected_count == count_within_dist(bytes1, bytes2, max_dist, elem_size)
+            else:
+                assert expected_count == count_within_dist(bytes1, bytes2, max_dist)
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,elem_size,msg",
+    (
+        (b"\x00" * 32, b"", 0, "`elem_to_compare` size must be >0"),
+        (b"\x00" * 32, b"\x00" * 16, -1, "`elem_size` must be >0"),
+        (b"\x00" * 32, b"\x00" * 15, 2, "`elem_to_compare` size must be multiplier of `elem_size`"),
+        (b"\x00" * 31, b"\x00" * 16, 0, "`array_of_elems` size must be multiplier of `elem_to_compare`"),
+    ),
+)
+def test_distance_histogram_invalid_values(bytes1, bytes2, elem_size, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = distance_histogram(bytes1, bytes2, elem_size)
+    assert msg in str(excinfo.value)
+    with pytest.raises(ValueError) as excinfo:
+        _ = count_within_dist(bytes1, bytes2, 3, elem_size)
+    assert msg in str(excinfo.value)
+
+
+def test_count_within_dist_negative_max_dist():
+    with pytest.raises(ValueError) as excinfo:
+        _ = count_within_dist(b"\x00" * 32, b"\x00" * 16, -1)
+    assert "`max_dist` must be >=0" in str(excinfo.value)
+
+
+@pytest.mark.parametrize("typecode", ("i", "q"))
+def test_check_bytes_offsets_within_dist(typecode):
+    random = Random(7)
+    lengths = [random.choice((3, 8, 16, 24, 32, 40, 64)) for _ in range(500)]
+    records = [bytes(random.getrandbits(8) for _ in range(length)) for length in lengths]
+    data = b"".join(records)
+    offsets = array(typecode, [0])
+    for record in records:
+        offsets.append(offsets[-1] + len(record))
+    queries = [records[10], records[250][:-1] + bytes([records[250][-1] ^ 1]), b"\x00" * 16, b"\x00" * 5,
+               records[499], b""]
+
+    def expected(query, max_dist):
+        return next((i for i, record in enumerate(records)
+                     if len(record) == len(query) and hamming_distance_bytes(record, query) <= max_dist), -1)
+
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        for max_dist in (0, 1, 40, 100):
+            assert [expected(query, max_dist) for query in queries] == \
+                check_bytes_offsets_within_dist(data, offsets, queries, max_dist)
+    # records may start after the beginning of data, as in a sliced Arrow array
+    assert [1] == check_bytes_offsets_within_dist(b"\xFF" * 4 + data, array(typecode, [4 + o for o in offsets]),
+                                                  [records[1]], 0)
+    assert [-1] == check_bytes_offsets_within_dist(b"", array(typecode, [0]), [b"\x00"], 8)
+
+
+def test_check_bytes_offsets_within_dist_long_query():
+    # queries are grouped by their distinct lengths, a long one costs no table of its size
+    long_record = b"\x01" * (16 << 20)
+    data = b"\x00" * 8 + long_record + b"\x02" * 8
+    offsets = array("q", [0, 8, 8 + len(long_record), len(data)])
+    assert [1, 0, 2, -1] == check_bytes_offsets_within_dist(data, offsets, [long_record, b"\x00" * 8, b"\x02" * 8,
+                                                                            b"\x00" * 9], 0)
+
+
+@pytest.mark.parametrize(
+    "data,offsets,queries,max_dist,msg",
+    (
+        (b"\x00" * 8, array("i", [0, 4, 8]), [b"\x00"], -1, "`max_dist` must be >=0"),
+        (b"\x00" * 8, array("i", [0, 4, 9]), [b"\x00"], 0, "`offsets` must be non-decreasing and within `data`"),
+        (b"\x00" * 8, array("i", [0, 5, 4]), [b"\x00"], 0, "`offsets` must be non-decreasing and within `data`"),
+        (b"\x00" * 8, array("q", [-1, 4]), [b"\x00"], 0, "`offsets` must be non-decreasing and within `data`"),
+        (b"\x00" * 8, array("i"), [b"\x00"], 0, "`offsets` must hold at least one value"),
+        (b"\x00" * 8, array("d", [0, 8]), [b"\x00"], 0, "`offsets` must be a buffer of int32 or int64"),
+        (b"\x00" * 8, b"\x00\x08", [b"\x00"], 0, "`offsets` must be a buffer of int32 or int64"),
+        (b"\x00" * 8, [0, 8], [b"\x00"], 0, "`offsets` must be a buffer of int32 or int64"),
+        (b"\x00" * 8, array("i", [0, 8]), [1], 0, "`elems_to_compare` must be a sequence of bytes"),
+        (b"\x00" * 8, array("i", [0, 8]), 1, 0, "`elems_to_compare` must be a sequence of bytes"),
+    ),
+)
+def test_check_bytes_offsets_within_dist_invalid_values(data, offsets, queries, max_dist, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = check_bytes_offsets_within_dist(data, offsets, queries, max_dist)
+    assert msg in str(excinfo.value)
+
+
+def sliding_hamming_reference(stream, pattern, max_dist, bit_granularity):
+    stream_bits, pattern_bits = len(stream) * 8, len(pattern) * 8
+    stream_value, pattern_value = int.from_bytes(stream, "big"), int.from_bytes(pattern, "big")
+    matches = []
+    for bit in range(0, stream_bits - pattern_bits + 1, 1 if bit_granularity else 8):
+        window = (stream_value >> (stream_bits - pattern_bits - bit)) & ((1 << pattern_bits) - 1)
+        distance = bin(window ^ pattern_value).count("1")
+        if distance <= max_dist:
+            matches.append((bit if bit_granularity else bit // 8, distance))
+    return matches
+
+
+@pytest.mark.parametrize("pattern_size", (1, 3, 7, 8, 9, 33))
+def test_sliding_hamming(pattern_size):
+    random = Random(pattern_size)
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for stream_size in (0, pattern_size - 1, pattern_size, pattern_size + 1, 100):
+        stream = bytes(random.getrandbits(8) for _ in range(stream_size))
+        pattern = bytes(random.getrandbits(8) for _ in range(pattern_size))
+        for max_dist in (0, pattern_size * 3, pattern_size * 8):
+            for bit_granularity in (False, True):
+                expected = sliding_hamming_reference(stream, pattern, max_dist, bit_granularity)
+                for algorithm in algorithm_list:
+                    result = set_algo(algorithm)
+                    if len(result) > 0:
+                        print(f'Warning: Skipping {algorithm}, reason: {result}')
+                        continue
+                    assert expected == sliding_hamming(stream, pattern, max_dist, bit_granularity)
+
+
+def test_sliding_hamming_sync_word():
+    sync_word = b"\x1A\xCF\xFC\x1D"
+    stream = bytearray(b"\x55" * 1000)
+    stream[100:104] = sync_word
+    stream[500:504] = b"\x1A\xCF\xFC\x1C"
+    assert [(100, 0), (500, 1)] == sliding_hamming(bytes(stream), sync_word, 1)
+    # the same stream delayed by 3 bits
+    delayed = (int.from_bytes(stream, "big") >> 3).to_bytes(len(stream), "big")
+    assert [(803, 0), (4003, 1)] == sliding_hamming(delayed, sync_word, 1, bit_granularity=True)
+    assert [] == sliding_hamming(delayed, sync_word, 1)
+
+
+@pytest.mark.parametrize(
+    "args,msg",
+    (
+        ((b"\x00" * 8, b"", 0), "`pattern` must not be empty"),
+        ((b"\x00" * 8, b"\x00", -1), "`max_dist` must be >=0"),
+        ((b"\x00" * 8, b"\x00", "0"), "error occurred while parsing arguments"),
+    ),
+)
+def test_sliding_hamming_invalid_values(args, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = sliding_hamming(*args)
+    assert msg in str(excinfo.value)
+
+
+def test_set_algo_from_threads():
+    array = b"\x01" * 64 * 4095 + b"\xCC" * 64
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    errors = []
+
+    def search():
+        for _ in range(50):
+            if check_bytes_arrays_within_dist(array, b"\xFB" * 64, 5 * 64) != 4095:
+                errors.append("wrong index")
+
+    def switch():
+        for i in range(500):
+            set_algo(algorithm_list[i % len(algorithm_list)])
+
+    threads = [Thread(target=search) for _ in range(4)] + [Thread(target=switch)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert [] == errors
+
+
+def test_submit_bytes_arrays_within_dist():
+    array = b"".join(bytes([i]) * 16 for i in range(256))
+    futures = [submit_bytes_arrays_within_dist(array, bytes([i]) * 16, 0) for i in range(256)]
+    assert list(range(256)) == [future.result(timeout=10) for future in futures]
+    assert -1 == submit_bytes_arrays_within_dist(array, b"\x01" * 15 + b"\x02", 0).result(timeout=10)
+    assert 1 == submit_bytes_arrays_within_dist(array, b"\x01" * 15 + b"\x02", 2).result(timeout=10)
+
+
+def test_submit_bytes_arrays_within_dist_asyncio():
+    async def search():
+        array = b"\x01" * 64 * 4095 + b"\xCC" * 64
+        futures = [asyncio.wrap_future(submit_bytes_arrays_within_dist(array, b"\xFB" * 64, 5 * 64))
+                   for _ in range(16)]
+        return await asyncio.gather(*futures)
+
+    assert [4095] * 16 == asyncio.run(search())
+
+
+@pytest.mark.parametrize(
+    "bytes1,bytes2,max_dist,exception,msg",
+    (
+        (b"\x00" * 16, b"\x00" * 16, None, ValueError, "error occurred while parsing arguments"),
+        ("\x00" * 16, b"\x00" * 16, 1, ValueError, "error occurred while parsing arguments"),
+        (b"\x00" * 32, b"\x00" * 16, -1, ValueError, "`max_dist` must be >=0"),
+        (b"\x00" * 31, b"\x00" * 16, 3, ValueError, "`array_of_elems` size must be multiplier of `elem_to_compare`"),
+        (b"\x00" * 32, b"", 3, ValueError, "`elem_to_compare` size must be >0"),
+    ),
+)
+def test_submit_bytes_arrays_within_dist_invalid_values(bytes1, bytes2, max_dist, exception, msg):
+    with pytest.raises(exception) as excinfo:
+        _ = submit_bytes_arrays_within_dist(bytes1, bytes2, max_dist)
+    assert msg in str(excinfo.value)
+
+
+def test_hamming_index():
+    def expected(query, max_dist):
+        return min((i for i, elem in live.items() if hamming_distance_bytes(elem, query) <= max_dist), default=-1)
+
+    index = HammingIndex(8, segment_size=100)
+    assert 8 == index.elem_size
+    assert 0 == len(index)
+    assert -1 == index.search(b"\x00" * 8, 0)
+    live = {i: i.to_bytes(8, "little") for i in range(1000)}
+    assert 0 == index.extend(b"".join(live.values()))
+    assert 1000 == index.append(b"\xFF" * 8)
+    live[1000] = b"\xFF" * 8
+    assert 1001 == len(index)
+    assert 300 == index.search((300).to_bytes(8, "little"), 0)
+    assert 1000 == index.search(b"\xFF" * 8, 0)
+    assert index.remove(300)
+    del live[300]
+    assert not index.remove(300)
+    assert not index.remove(5000)
+    assert 1000 == len(index)
+    queries = [(300).to_bytes(8, "little"), (500).to_bytes(8, "little"), (999).to_bytes(8, "little"), b"\xFF" * 8]
+    for query in queries:
+        for max_dist in range(4):
+            assert expected(query, max_dist) == index.search(query, max_dist)
+            assert expected(query, max_dist) == index.search(query, max_dist, parallel=True)
+    for i in range(0, 1000, 2):
+        index.remove(i)
+        live.pop(i, None)
+    index.compact()
+    assert len(live) == len(index)
+    for query in queries:
+        for max_dist in range(4):
+            assert expected(query, max_dist) == index.search(query, max_dist)
+            assert expected(query, max_dist) == index.search(query, max_dist, parallel=True)
+    assert index.remove(501)
+    del live[501]
+    assert 1001 == index.append(b"\x00" * 8)
+    live[1001] = b"\x00" * 8
+    index.compact()
+    for query in queries + [b"\x00" * 8]:
+        for max_dist in range(4):
+            assert expected(query, max_dist) == index.search(query, max_dist)
+            assert expected(query, max_dist) == index.search(query, max_dist, parallel=True)
+
+
+def test_hamming_index_huge_segments():
+    # segments of 2 MB are mapped with huge pages
+    index = HammingIndex(64, segment_size=32768)
+    index.extend(b"\x01" * 64 * 100000 + b"\xCC" * 64)
+    index.append(b"\xCC" * 64)
+    for parallel in (False, True):
+        assert 100000 == index.search(b"\xFB" * 64, 5 * 64, parallel=parallel)
+        assert 0 == index.search(b"\x01" * 64, 0, parallel=parallel)
+        assert -1 == index.search(b"\x00" * 64, 0, parallel=parallel)
+    assert index.remove(100000)
+    for i in range(0, 50000):
+        index.remove(i)
+    index.compact()
+    assert 50001 == len(index)
+    for parallel in (False, True):
+        assert 100001 == index.search(b"\xFB" * 64, 5 * 64, parallel=parallel)
+        assert 50000 == index.search(b"\x01" * 64, 0, parallel=parallel)
+
+
+def test_hamming_index_concurrent_updates():
+    index = HammingIndex(16, segment_size=64)
+    index.extend(b"\x0F" * 16 * 10000)
+    errors = []
+
+    def update():
+        for i in range(0, 10000, 3):
+            index.remove(i)
+            index.append(b"\xF0" * 16)
+            if i % 300 == 0:
+                index.compact()
+
+    def search():
+        for _ in range(200):
+            if index.search(b"\xF0" * 16, 0) not in (-1,) + tuple(range(10000, 20000)):
+                errors.append("wrong id")
+            if index.search(b"\x0F" * 16, 0) == -1:
+                errors.append("lost record")
+
+    threads = [Thread(target=update)] + [Thread(target=search) for _ in range(3)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    index.compact()
+    assert [] == errors
+    assert 10000 == len(index)
+    assert 10000 == index.search(b"\xF0" * 16, 0)
+
+
+@pytest.mark.parametrize(
+    "method,args,msg",
+    (
+        ("append", (b"\x00" * 7,), "`elem` size must be equal to `elem_size`"),
+        ("extend", (b"\x00" * 9,), "`array_of_elems` size must be multiplier of `elem_size`"),
+        ("search", (b"\x00" * 7, 1), "`elem_to_compare` size must be equal to `elem_size`"),
+        ("search", (b"\x00" * 8, -1), "`max_dist` must be >=0"),
+        ("remove", ("a",), "error occurred while parsing arguments"),
+    ),
+)
+def test_hamming_index_invalid_values(method, args, msg):
+    index = HammingIndex(8)
+    with pytest.raises(ValueError) as excinfo:
+        _ = getattr(index, method)(*args)
+    assert msg in str(excinfo.value)
+    with pytest.raises(ValueError):
+        HammingIndex(0)
+
+
+def expected_rerank(codes, query, vectors, query_vector, k, candidates, max_dist, metric):
+    elem_size, dimensions = len(query), len(query_vector)
+    shortlist = sorted((sum(bin(x ^ y).count("1") for x, y in zip(codes[i:i + elem_size], query)), i // elem_size)
+                       for i in range(0, len(codes), elem_size))
+    shortlist = [(d, i) for d, i in shortlist if max_dist < 0 or d <= max_dist]
+    if candidates:
+        shortlist = shortlist[:candidates]
+    scored = []
+    for _, i in shortlist:
+        vector = vectors[i * dimensions:(i + 1) * dimensions]
+        if metric == "dot":
+            scored.append((-sum(a * b for a, b in zip(vector, query_vector)), i))
+        else:
+            scored.append((sum((a - b) ** 2 for a, b in zip(vector, query_vector)), i))
+    return [(i, -score if metric == "dot" else score) for score, i in sorted(scored)[:k]]
+
+
+def test_hamming_rerank():
+    rng = Random(43)
+    cases = []
+    for dimensions in (1, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 70):
+        for elem_size in (3, 8, 32):
+            codes = bytes(rng.getrandbits(8) for _ in range(40 * elem_size))
+            query = bytes(rng.getrandbits(8) for _ in range(elem_size))
+            # small integers keep float sums exact in every summation order
+            vectors = array("f", (rng.randint(-4, 4) for _ in range(40 * dimensions)))
+            query_vector = array("f", (rng.randint(-4, 4) for _ in range(dimensions)))
+            for k, candidates, max_dist in ((5, 0, -1), (5, 12, -1), (3, 0, elem_size * 4), (40, 7, elem_size * 4)):
+                for metric in ("dot", "l2"):
+                    cases.append((codes, query, vectors, query_vector, k, candidates, max_dist, metric))
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        for codes, query, vectors, query_vector, k, candidates, max_dist, metric in cases:
+            assert expected_rerank(codes, query, vectors, query_vector, k, candidates, max_dist, metric) == \
+                hamming_rerank(codes, query, vectors, query_vector, k, candidates=candidates, max_dist=max_dist,
+                               metric=metric)
+
+
+def test_hamming_rerank_nan():
+    codes = b"\x00" * 6
+    vectors = array("f", [1.0, float("nan"), 3.0, float("nan"), 2.0, -1.0])
+    for metric, scores in (("dot", [3.0, 2.0, 1.0, -1.0]), ("l2", [0.0, 1.0, 4.0, 4.0])):
+        ranked = hamming_rerank(codes, b"\x00", vectors, array("f", [1.0]), 6, metric=metric)
+        assert [index for index, _ in ranked[:4]] == ([2, 4, 0, 5] if metric == "dot" else [0, 4, 2, 5])
+        assert [score for _, score in ranked[:4]] == scores
+        assert [index for index, _ in ranked[4:]] == [1, 3]
+        assert all(isnan(score) for _, score in ranked[4:])
+
+
+def test_hamming_rerank_empty():
+    assert [] == hamming_rerank(b"", b"\x00", array("f"), array("f", [1.0]), 3)
+    assert [] == hamming_rerank(b"\xff", b"\x00", array("f", [1.0]), array("f", [1.0]), 3, max_dist=7)
+
+
+@pytest.mark.parametrize(
+    "codes,query,vectors,query_vector,k,kwargs,msg",
+    (
+        (b"\x00" * 4, b"", array("f", [0.0]), array("f", [0.0]), 1, {}, "`elem_to_compare` size must be >0"),
+        (b"\x00" * 3, b"\x00" * 2, array("f", [0.0]), array("f", [0.0]), 1, {},
+         "`array_of_elems` size must be multiplier of `elem_to_compare`"),
+        (b"\x00" * 2, b"\x00" * 2, array("f", [0.0]), array("f", [0.0]), 0, {}, "`k` must be >0"),
+        (b"\x00" * 2, b"\x00" * 2, array("f", [0.0]), array("f", [0.0]), 1, {"candidates": -1},
+         "`candidates` must be >=0"),
+        (b"\x00" * 2, b"\x00" * 2, array("f", [0.0]), array("f", [0.0]), 1, {"max_dist": -2},
+         "`max_dist` must be >=0 or -1"),
+        (b"\x00" * 2, b"\x00" * 2, array("f", [0.0]), array("f", [0.0]), 1, {"metric": "cosine"},
+         "`metric` must be \"dot\" or \"l2\""),
+        (b"\x00" * 2, b"\x00" * 2, array("d", [0.0]), array("f", [0.0]), 1, {},
+         "`vectors` must be a buffer of float32"),
+        (b"\x00" * 2, b"\x00" * 2, array("f", [0.0]), b"\x00" * 4, 1, {},
+         "`query_vector` must be a buffer of float32"),
+        (b"\x00" * 2, b"\x00" * 2, array("f", [0.0]), array("f"), 1, {}, "`query_vector` must not be empty"),
+        (b"\x00" * 4, b"\x00" * 2, array("f", [0.0] * 3), array("f", [0.0]), 1, {},
+         "`vectors` must hold one vector of `query_vector` size per element"),
+    ),
+)
+def test_hamming_rerank_invalid_values(codes, query, vectors, query_vector, k, kwargs, msg):
+    with pytest.raises(ValueError) as excinfo:
+        _ = hamming_rerank(codes, query, vectors, query_vector, k, **kwargs)
+    assert msg in str(excinfo.value)
+
+
+############################
+# shared memory index tests
+############################
+
+
+@pytest.fixture
+def shared_index_name():
+    name = "hexhamming-test-%d" % getpid()
+    yield name
+    try:
+        unlink_shared_index(name)
+    except OSError:
+        pass
+
+
+@pytest.mark.skipif(system() == "Windows", reason="POSIX shared memory only")
+def test_shared_index(shared_index_name):
+    records = b"\x00" * 8 * 100 + b"\x0F" * 8 + b"\xFF" * 8 * 100
+    publish_shared_index(shared_index_name, records, 8)
+    index = SharedIndex(shared_index_name)
+    assert 201 == len(index)
+    assert 8 == index.elem_size
+    assert bytes(memoryview(index)) == records
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        assert 0 == index.search(b"\x00" * 8, 0)
+        assert 100 == index.search(b"\x0F" * 8, 0)
+        assert 100 == index.search(b"\x0F" * 7 + b"\x07", 1)
+        assert -1 == index.search(b"\x0F" * 7 + b"\x07", 0)
+        assert 100 == check_bytes_arrays_within_dist(index, b"\x0F" * 8, 0)
+    # attach from another process
+    found = check_output([executable, "-c",
+                          "from hexhamming import SharedIndex; print(SharedIndex(%r).search(b'\\xFF' * 8, 0))"
+                          % shared_index_name])
+    assert b"101" == found.strip()
+    # unlinking keeps existing mappings alive
+    unlink_shared_index(shared_index_name)
+    assert 101 == index.search(b"\xFF" * 8, 0)
+    with pytest.raises(OSError):
+        SharedIndex(shared_index_name)
+
+
+@pytest.mark.skipif(system() == "Windows", reason="POSIX shared memory only")
+def test_shared_index_errors(shared_index_name):
+    publish_shared_index(shared_index_name, b"\x00" * 16, 8)
+    with pytest.raises(OSError):
+        publish_shared_index(shared_index_name, b"\x00" * 16, 8)
+    with pytest.raises(ValueError) as excinfo:
+        publish_shared_index(shared_index_name + "-1", b"\x00" * 9, 8)
+    assert "`array_of_elems` size must be multiplier of `elem_size`" in str(excinfo.value)
+    with pytest.raises(ValueError) as excinfo:
+        SharedIndex(shared_index_name).search(b"\x00" * 7, 0)
+    assert "`elem_to_compare` size must be equal to `elem_size`" in str(excinfo.value)
+    with pytest.raises(OSError):
+        SharedIndex(shared_index_name + "-missing")
+
+
+############################
+# popcount index tests
+############################
+
+@pytest.mark.parametrize("elem_size", (3, 8, 16, 32))
+def test_popcount_index(elem_size):
+    rng = Random(39)
+    # skewed set: most records have few bits set
+    records = [bytes(rng.getrandbits(8) & rng.getrandbits(8) & rng.getrandbits(8) for _ in range(elem_size))
+               for _ in range(300)]
+    records += [bytes(rng.getrandbits(8) for _ in range(elem_size)) for _ in range(50)]
+    records += [records[7], records[300]]
+    queries = [records[0], records[310], bytes(elem_size), b"\xFF" * elem_size]
+
+    def distance(a, b):
+        return sum(bin(x ^ y).count("1") for x, y in zip(a, b))
+
+    algorithm_list = ['extra', 'native', 'classic']
+    if machine().lower().startswith('x86'):
+        algorithm_list += ['sse41', 'avx512']
+    for algorithm in algorithm_list:
+        result = set_algo(algorithm)
+        if len(result) > 0:
+            print(f'Warning: Skipping {algorithm}, reason: {result}')
+            continue
+        index = PopcountIndex(b"".join(records), elem_size)
+        assert len(index) == len(records)
+        assert index.elem_size == elem_size
+        for query in queries:
+            distances = [distance(record, query) for record in records]
+            for max_dist in (0, 1, elem_size, elem_size * 3, elem_size * 8):
+                expected = [i for i, d in enumerate(distances) if d <= max_dist]
+                assert expected == index.within(query, max_dist)
+            ranked = sorted((d, i) for i, d in enumerate(distances))
+            for k in (0, 1, 5, 17, len(records), len(records) + 5):
+                assert [(i, d) for d, i in ranked[:k]] == index.nearest(query, k)
+
+
+def test_popcount_index_empty():
+    index = PopcountIndex(b"", 8)
+    assert len(index) == 0
+    assert [] == index.within(b"\x00" * 8, 64)
+    assert [] == index.nearest(b"\x00" * 8, 3)
+
+
+@pytest.mark.parametrize(
+    "args,msg",
+    (
+        ((b"\x00" * 16, 0), "`elem_size` must be >0"),
+        ((b"\x00" * 17, 8), "`array_of_elems` size must be multiplier of `elem_size`"),
+        (("abc", None), "error occurred while parsing arguments"),
+    ),
+)
+def test_popcount_index_invalid_values(args, msg):
+    with pytest.raises(ValueError) as excinfo:
+        PopcountIndex(*args)
+    assert msg in str(excinfo.value)
+
+
+def test_popcount_index_search_invalid_values():
+    index = PopcountIndex(b"\x00" * 16, 8)
+    with pytest.raises(ValueError) as excinfo:
+        index.within(b"\x00" * 7, 1)
+    assert "`elem_to_compare` size must be equal to `elem_size`" in str(excinfo.value)
+    with pytest.raises(ValueError) as excinfo:
+        index.within(b"\x00" * 8, -1)
+    assert "`max_dist` must be >=0" in str(excinfo.value)
+    with pytest.raises(ValueError) as excinfo:
+        index.nearest(b"\x00" * 8, -1)
+    assert "`k` must be >=0" in str(excinfo.value)
+    with pytest.raises(ValueError) as excinfo:
+        index.nearest(b"\x00" * 8, "3")
+    assert "error occurred while parsing arguments" in str(excinfo.value)
+
+
+############################
+# latency histogram tests
+############################
+
+def test_latency_histograms():
+    set_latency_histograms(True)
+    try:
+        for _ in range(3):
+            hamming_distance_bytes(b"\x00" * 8, b"\xFF" * 8)
+        hamming_distance_string("abc", "abd")
+        with pytest.raises(ValueError):
+            hamming_distance_string("abc", "xyz")
+        assert 0 == check_bytes_arrays_within_dist(b"\x00" * 32, b"\x01" * 8, 8)
+        index = PopcountIndex(b"\x00" * 32, 8)
+        index.within(b"\x00" * 8, 1)
+        index.nearest(b"\x00" * 8, 2)
+        histograms = get_latency_histograms()
+    finally:
+        set_latency_histograms(False)
+
+    assert {"hamming_distance_bytes", "hamming_distance_string", "check_bytes_arrays_within_dist",
+            "PopcountIndex", "PopcountIndex.within", "PopcountIndex.nearest"} == set(histograms)
+    for histogram in histograms.values():
+        assert 40 == len(histogram)
+    assert 3 == sum(histograms["hamming_distance_bytes"])
+    # calls raising errors are recorded too
+    assert 2 == sum(histograms["hamming_distance_string"])
+    assert 1 == sum(histograms["PopcountIndex.nearest"])
+
+
+def test_latency_histograms_index_maintenance():
+    set_latency_histograms(True)
+    try:
+        index = HammingIndex(4, segment_size=2)
+        index.append(b"\x00" * 4)
+        index.extend(b"\x01" * 12)
+        index.remove(0)
+        index.compact()
+        assert 0 == submit_bytes_arrays_within_dist(b"\x00" * 8, b"\x00" * 4, 0).result(timeout=10)
+        histograms = get_latency_histograms()
+    finally:
+        set_latency_histograms(False)
+
+    assert {"HammingIndex", "HammingIndex.append", "HammingIndex.extend", "HammingIndex.remove",
+            "HammingIndex.compact", "submit_bytes_arrays_within_dist"} == set(histograms)
+    assert all(1 == sum(histogram) for histogram in histograms.values())
+
+
+@pytest.mark.skipif(system() == "Windows", reason="POSIX shared memory only")
+def test_latency_histograms_shared_index(shared_index_name):
+    set_latency_histograms(True)
+    try:
+        publish_shared_index(shared_index_name, b"\x00" * 16, 8)
+        SharedIndex(shared_index_name)
+        unlink_shared_index(shared_index_name)
+        with pytest.raises(OSError):
+            SharedIndex(shared_index_name)
+        set_algo("classic")
+        histograms = get_latency_histograms()
+    finally:
+        set_latency_histograms(False)
+
+    assert {"publish_shared_index", "SharedIndex", "unlink_shared_index", "set_algo"} == set(histograms)
+    assert 2 == sum(histograms["SharedIndex"])
+
+
+def test_latency_histograms_disabled():
+    set_latency_histograms(True)
+    hamming_distance_bytes(b"\x00", b"\x01")
+    set_latency_histograms(False)
+    hamming_distance_bytes(b"\x00", b"\x01")
+    assert 1 == sum(get_latency_histograms()["hamming_distance_bytes"])
+    # enabling again starts from empty histograms
+    set_latency_histograms(True)
+    set_latency_histograms(False)
+    assert {} == get_latency_histograms()
+
+
+def test_latency_histograms_invalid_values():
+    with pytest.raises(ValueError) as excinfo:
+        set_latency_histograms()
+    assert "error occurred while parsing arguments" in str(excinfo.value)
+
+
 @pytest.mark.benchmark(group="hamming_distance_string")
 @pytest.mark.parametrize(
     ("hex1", "hex2"),
@@ -268,6 +1290,26 @@ def test_hamming_distance_bytes_bench(benchmark, hex1, hex2):
     benchmark(hamming_distance_bytes, hex1, hex2)
 
 
+@pytest.mark.benchmark(group="hamming_distance_bytes")
+def test_hamming_distance_bytes_latency_histograms_bench(benchmark):
+    set_latency_histograms(True)
+    try:
+        benchmark(hamming_distance_bytes, b"\xFF" * 32, b"\x00" * 32)
+    finally:
+        set_latency_histograms(False)
+
+
+@pytest.mark.benchmark(group="hamming_distance_pairs")
+@pytest.mark.parametrize("kind", ("str", "bytes"))
+def test_hamming_distance_pairs_bench(benchmark, kind):
+    rng = Random(48)
+    seq_a = ["%016x" % rng.getrandbits(64) for _ in range(10000)]
+    seq_b = ["%016x" % rng.getrandbits(64) for _ in range(10000)]
+    if kind == "bytes":
+        seq_a, seq_b = [bytes.fromhex(a) for a in seq_a], [bytes.fromhex(b) for b in seq_b]
+    benchmark(hamming_distance_pairs, seq_a, seq_b)
+
+
 def test_check_hexstrings_within_dist_bench(benchmark):
     benchmark(check_hexstrings_within_dist, "F" * 1000, "0" * 1000, 20)
 
@@ -309,3 +1351,113 @@ def test_check_hexstrings_within_dist_bench(benchmark):
 )
 def test_check_bytes_arrays_within_dist_bench(benchmark, bytes1, bytes2, max_dist):
     benchmark(check_bytes_arrays_within_dist, bytes1, bytes2, max_dist)
+
+
+@pytest.mark.benchmark(group="hamming_distance_bytes_arrays_within_dist")
+@pytest.mark.parametrize("elem_size", (8, 16), ids=("s=8", "s=16"))
+def test_check_bytes_arrays_within_dist_short_records_bench(benchmark, elem_size):
+    records = b"\x01" * elem_size * 65535 + b"\xCC" * elem_size
+    benchmark(check_bytes_arrays_within_dist, records, b"\xFB" * elem_size, 5 * elem_size)
+
+
+@pytest.mark.benchmark(group="hamming_distance_bytes_arrays_within_dist")
+@pytest.mark.parametrize("elem_size", (256, 1024, 4096), ids=("s=256", "s=1024", "s=4096"))
+def test_check_bytes_arrays_within_dist_rejects_bench(benchmark, elem_size):
+    # random records are rejected after about 40% of their bytes
+    rng = Random(41)
+    records = bytes(rng.getrandbits(8) for _ in range(256 * elem_size))
+    query = bytes(rng.getrandbits(8) for _ in range(elem_size))
+    benchmark(check_bytes_arrays_within_dist, records, query, elem_size * 8 // 5)
+
+
+@pytest.mark.benchmark(group="hamming_rerank")
+@pytest.mark.parametrize("metric", ("dot", "l2"))
+def test_hamming_rerank_bench(benchmark, metric):
+    rng = Random(47)
+    codes = bytes(rng.getrandbits(8) for _ in range(16384 * 16))
+    vectors = array("f", (rng.random() for _ in range(16384 * 128)))
+    query_vector = array("f", (rng.random() for _ in range(128)))
+    benchmark(hamming_rerank, codes, codes[:16], vectors, query_vector, 10, candidates=200, metric=metric)
+
+
+@pytest.mark.benchmark(group="tanimoto_bytes_arrays")
+def test_check_bytes_arrays_within_tanimoto_bench(benchmark):
+    benchmark(check_bytes_arrays_within_tanimoto, b"\x11" * 256 * 4095 + b"\xFF" * 256, b"\xFB" * 256, 0.9)
+
+
+@pytest.mark.benchmark(group="hamming_distance_bytes_arrays_within_dist")
+def test_check_bitsliced_within_dist_bench(benchmark):
+    sliced = bitslice_bytes_array(b"\x01" * 8 * 65535 + b"\xCC" * 8, 8)
+    benchmark(check_bitsliced_within_dist, sliced, 65536, b"\xFB" * 8, 16)
+
+
+@pytest.mark.benchmark(group="hamming_distance_bytes_arrays_within_dist")
+@pytest.mark.parametrize("permuted", (False, True), ids=("original", "permuted"))
+def test_check_bytes_arrays_within_dist_variance_permutation_bench(benchmark, permuted):
+    records = hash_like_records(4096, 256, 45)
+    query = hash_like_records(1, 256, 46)
+    if permuted:
+        permutation = variance_permutation(records, 256)
+        records = permute_bytes_array(records, permutation)
+        query = permute_bytes_array(query, permutation)
+    benchmark(check_bytes_arrays_within_dist, records, query, 200)
+
+
+@pytest.mark.benchmark(group="distance_histogram")
+def test_distance_histogram_bench(benchmark):
+    benchmark(distance_histogram, b"\x01" * 32 * 16384, b"\xFB" * 32)
+
+
+@pytest.mark.benchmark(group="hamming_distance_bytes_arrays_within_dist")
+def test_check_bytes_offsets_within_dist_bench(benchmark):
+    data = (b"\x01" * 32 + b"\x01" * 48) * 8191 + b"\xCC" * 32 + b"\x01" * 48
+    offsets = array("q", [0])
+    for _ in range(8192):
+        offsets.extend((offsets[-1] + 32, offsets[-1] + 80))
+    benchmark(check_bytes_offsets_within_dist, data, offsets, [b"\xFB" * 32, b"\xFB" * 48], 5 * 32)
+
+
+@pytest.mark.benchmark(group="sliding_hamming")
+def test_sliding_hamming_bench(benchmark):
+    benchmark(sliding_hamming, b"\x55" * 1024 * 1024, b"\x1A\xCF\xFC\x1D", 2)
+
+
+@pytest.mark.benchmark(group="sliding_hamming")
+def test_sliding_hamming_bits_bench(benchmark):
+    benchmark(sliding_hamming, b"\x55" * 1024 * 1024, b"\x1A\xCF\xFC\x1D", 2, True)
+
+
+@pytest.mark.benchmark(group="hamming_distance_bytes_arrays_within_dist")
+def test_hamming_index_search_bench(benchmark):
+    index = HammingIndex(64)
+    index.extend(b"\x01" * 64 * 16383 + b"\xCC" * 64)
+    for i in range(0, 16383, 7):
+        index.remove(i)
+    benchmark(index.search, b"\xFB" * 64, 5 * 64)
+
+
+@pytest.mark.benchmark(group="hamming_distance_bytes_arrays_within_dist")
+def test_hamming_index_parallel_search_bench(benchmark):
+    index = HammingIndex(64, segment_size=4096)
+    index.extend(b"\x01" * 64 * 16383 + b"\xCC" * 64)
+    for i in range(0, 16383, 7):
+        index.remove(i)
+    benchmark(index.search, b"\xFB" * 64, 5 * 64, parallel=True)
+
+
+def skewed_records(elem_size, count):
+    rng = Random(39)
+    return b"".join(bytes(rng.getrandbits(8) & rng.getrandbits(8) & rng.getrandbits(8) for _ in range(elem_size))
+                    for _ in range(count))
+
+
+@pytest.mark.benchmark(group="popcount_index")
+def test_popcount_index_within_bench(benchmark):
+    index = PopcountIndex(skewed_records(8, 65536), 8)
+    benchmark(index.within, b"\xF7" * 8, 8)
+
+
+@pytest.mark.benchmark(group="popcount_index")
+def test_popcount_index_nearest_bench(benchmark):
+    index = PopcountIndex(skewed_records(8, 65536), 8)
+    benchmark(index.nearest, b"\xF7" * 8, 10)
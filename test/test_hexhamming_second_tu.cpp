@@ -0,0 +1,10 @@
+// Second translation unit of the C++ checks: the header must give every TU the same kernels and tables.
+#include "hexhamming/hexhamming.hpp"
+
+const hexhamming::detail::hexhamming_kernels* second_tu_kernels(const hexhamming::algorithm algorithm) {
+    return hexhamming::dispatcher(algorithm).kernels();
+}
+
+const hexhamming::detail::hexhamming_kernels* second_tu_classic_table() {
+    return &hexhamming::detail::KERNELS__CLASSIC;
+}